@@ -14,110 +14,327 @@
 
 #include "examples/ecdhpsi/ecdh_psi.h"
 
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
+#include <future>
 #include <memory>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <unordered_set>
 #include <vector>
 
+#include "examples/psi/mask_intersection.h"
+#include "examples/psi/mask_packing.h"
+#include "examples/psi/point_batch.h"
+
 #include "yacl/crypto/ecc/ec_point.h"
 #include "yacl/crypto/ecc/ecc_spi.h"
+#include "yacl/crypto/hash/hash_utils.h"
+#include "yacl/math/gadget.h"
+
+namespace {
+
+size_t BatchSize(size_t n, size_t batch_size) {
+  return std::max<size_t>(1, batch_size == 0 ? n : std::min(n, batch_size));
+}
 
-inline std::vector<size_t> GetIntersectionIdx(
-    const std::vector<std::string>& x, const std::vector<std::string>& y) {
-  std::set<std::string> set(x.begin(), x.end());
-  std::vector<size_t> ret;
-  for (size_t i = 0; i < y.size(); ++i) {
-    if (set.count(y[i]) != 0) {
-      ret.push_back(i);
+// Receives batches of serialized points from the previous rank on in_ctx,
+// raises them to sk and sends them to dst on out_ctx, either serialized or,
+// if digest_bits is non-zero, as packed digests of that many bits.
+void MaskPeerBatches(const std::shared_ptr<yacl::link::Context>& in_ctx,
+                     const std::shared_ptr<yacl::link::Context>& out_ctx,
+                     size_t dst, EcdhPsi& party, size_t size,
+                     size_t batch_size, size_t digest_bits) {
+  uint64_t point_length = party.ec_->GetSerializeLength();
+  size_t batch = BatchSize(size, batch_size);
+  std::vector<yc::EcPoint> points(batch);
+  std::vector<yc::EcPoint> masked(batch);
+  std::vector<uint128_t> digests(digest_bits == 0 ? 0 : batch);
+  std::vector<uint8_t> buffer(batch * point_length);
+  for (size_t begin = 0; begin < size; begin += batch) {
+    size_t n = std::min(batch, size - begin);
+    auto buf = in_ctx->Recv(in_ctx->PrevRank(), "Receive H(id)^b");
+    YACL_ENFORCE(buf.size() == int64_t(n * point_length));
+    std::memcpy(buffer.data(), buf.data(), buf.size());
+    party.BuffertoPoints(absl::MakeSpan(points).subspan(0, n),
+                         absl::MakeSpan(buffer));
+    size_t length = n * point_length;
+    if (digest_bits == 0) {
+      party.MaskEcPoints(absl::MakeSpan(points).subspan(0, n),
+                         absl::MakeSpan(masked).subspan(0, n));
+      party.PointstoBuffer(absl::MakeSpan(masked).subspan(0, n),
+                           absl::MakeSpan(buffer));
+    } else {
+      party.MaskEcPointsDigest(absl::MakeSpan(points).subspan(0, n),
+                               absl::MakeSpan(digests).subspan(0, n));
+      length = examples::psi::PackedSize(n, digest_bits);
+      examples::psi::PackMasks(absl::MakeSpan(digests).subspan(0, n),
+                               digest_bits,
+                               absl::MakeSpan(buffer.data(), length));
     }
+    out_ctx->SendAsyncThrottled(
+        dst, yacl::ByteContainerView(buffer.data(), length), "Send y_mask");
   }
-  return ret;
 }
 
+// Receives batches of serialized points from the previous rank and writes
+// the digests of the points raised to sk, truncated to digest_bits, to out.
+void DigestPeerBatches(const std::shared_ptr<yacl::link::Context>& ctx,
+                       EcdhPsi& party, size_t batch_size, size_t digest_bits,
+                       absl::Span<uint128_t> out) {
+  uint64_t point_length = party.ec_->GetSerializeLength();
+  size_t batch = BatchSize(out.size(), batch_size);
+  std::vector<yc::EcPoint> points(batch);
+  for (size_t begin = 0; begin < out.size(); begin += batch) {
+    size_t n = std::min(batch, out.size() - begin);
+    auto buf = ctx->Recv(ctx->PrevRank(), "Receive H(id)^a");
+    YACL_ENFORCE(buf.size() == int64_t(n * point_length));
+    party.BuffertoPoints(absl::MakeSpan(points).subspan(0, n),
+                         absl::MakeSpan(buf.data<uint8_t>(), buf.size()));
+    party.MaskEcPointsDigest(absl::MakeSpan(points).subspan(0, n),
+                             out.subspan(begin, n));
+  }
+  examples::psi::TruncateMasks(out, digest_bits);
+}
+
+// Receives batches of digests packed by MaskPeerBatches from src.
+void RecvPackedDigests(const std::shared_ptr<yacl::link::Context>& ctx,
+                       size_t src, size_t batch_size, size_t digest_bits,
+                       absl::Span<uint128_t> out) {
+  size_t batch = BatchSize(out.size(), batch_size);
+  for (size_t begin = 0; begin < out.size(); begin += batch) {
+    size_t n = std::min(batch, out.size() - begin);
+    auto buf = ctx->Recv(src, "Receive y_mask");
+    YACL_ENFORCE(buf.size() ==
+                 int64_t(examples::psi::PackedSize(n, digest_bits)));
+    examples::psi::UnpackMasks(absl::MakeSpan(buf.data<uint8_t>(), buf.size()),
+                               digest_bits, out.subspan(begin, n));
+  }
+}
+
+// Masks the inputs with sk batch by batch and sends the serialized points to
+// the next rank.
+void SendMaskedBatches(const std::shared_ptr<yacl::link::Context>& ctx,
+                       EcdhPsi& party, std::vector<std::string>& in,
+                       size_t batch_size, std::string_view tag) {
+  uint64_t point_length = party.ec_->GetSerializeLength();
+  size_t batch = BatchSize(in.size(), batch_size);
+  std::vector<yc::EcPoint> points(batch);
+  std::vector<uint8_t> buffer(batch * point_length);
+  for (size_t begin = 0; begin < in.size(); begin += batch) {
+    size_t n = std::min(batch, in.size() - begin);
+    party.MaskStrings(absl::MakeSpan(in).subspan(begin, n),
+                      absl::MakeSpan(points).subspan(0, n));
+    party.PointstoBuffer(absl::MakeSpan(points).subspan(0, n),
+                         absl::MakeSpan(buffer));
+    ctx->SendAsyncThrottled(
+        ctx->NextRank(), yacl::ByteContainerView(buffer.data(), n * point_length),
+        tag);
+  }
+}
+
+}  // namespace
+
 void EcdhPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
-                 std::vector<std::string>& x, size_t size_y) {
+                 std::vector<std::string>& x, size_t size_y,
+                 size_t batch_size, bool short_digest,
+                 examples::psi::LinkTraffic* spawned_traffic) {
   EcdhPsi alice;
-  std::vector<yc::EcPoint> x_points(x.size());
-  alice.MaskStrings(absl::MakeSpan(x), absl::MakeSpan(x_points));
+  std::shared_ptr<yacl::link::Context> y_ctx = ctx->Spawn();
+  ctx->SetThrottleWindowSize(kSendWindow);
+  y_ctx->SetThrottleWindowSize(kSendWindow);
 
   // Send H(id)^a
-  uint64_t max_point_length =
-      alice.ec_->GetSerializeLength();  // 获取点的最大序列化长度
-  uint64_t total_length_x = max_point_length * x.size();
-
-  std::vector<uint8_t> xbuffer(total_length_x);
-  alice.PointstoBuffer(absl::MakeSpan(x_points), absl::MakeSpan(xbuffer));
-  ctx->SendAsync(
-      ctx->NextRank(),
-      yacl::ByteContainerView(xbuffer.data(), total_length_x * sizeof(uint8_t)),
-      "Send H(id)^a");
-
-  // Receive H(id)^b
-  uint64_t total_length_y = max_point_length * size_y;
-  std::vector<uint8_t> ybuffer(total_length_y);
-  std::vector<yc::EcPoint> y_points(size_y);
-  auto bufypoints = ctx->Recv(ctx->PrevRank(), "Receive H(id)^b");
-  YACL_ENFORCE(bufypoints.size() == int64_t(total_length_y * sizeof(uint8_t)));
-  std::memcpy(ybuffer.data(), bufypoints.data(), bufypoints.size());
-  alice.BuffertoPoints(absl::MakeSpan(y_points), absl::MakeSpan(ybuffer));
-
-  std::vector<yc::EcPoint> y_mask(size_y);
-  // y_str = y_points ^ {alice_sk}
-  alice.MaskEcPoints(absl::MakeSpan(y_points), absl::MakeSpan(y_mask));
-  std::vector<uint8_t> maskbuffer(total_length_y);
-  alice.PointstoBuffer(absl::MakeSpan(y_mask), absl::MakeSpan(maskbuffer));
-
-  ctx->SendAsync(ctx->NextRank(),
-                 yacl::ByteContainerView(maskbuffer.data(),
-                                         maskbuffer.size() * sizeof(uint8_t)),
-                 "Send y_mask");
+  auto send_x = std::async(std::launch::async, [&] {
+    SendMaskedBatches(ctx, alice, x, batch_size, "Send H(id)^a");
+  });
+
+  // Receive H(id)^b, send y_mask = H(id)^ba
+  size_t digest_bits =
+      short_digest
+          ? examples::psi::MaskLength(kStatSecParam, x.size(), size_y)
+          : 0;
+  MaskPeerBatches(y_ctx, y_ctx, y_ctx->NextRank(), alice, size_y, batch_size,
+                  digest_bits);
+  send_x.get();
+  if (spawned_traffic != nullptr) {
+    spawned_traffic->Add(*y_ctx);
+  }
 }
 
 std::vector<size_t> EcdhPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
-                                std::vector<std::string>& y, size_t size_x) {
+                                std::vector<std::string>& y, size_t size_x,
+                                size_t batch_size, bool short_digest,
+                                examples::psi::LinkTraffic* spawned_traffic) {
   EcdhPsi bob;
-  std::vector<yc::EcPoint> y_points(y.size());
-  // y_points = H(y) ^ {bob_sk}
-  bob.MaskStrings(absl::MakeSpan(y), absl::MakeSpan(y_points));
-  uint64_t max_point_length =
+  std::shared_ptr<yacl::link::Context> y_ctx = ctx->Spawn();
+  ctx->SetThrottleWindowSize(kSendWindow);
+  y_ctx->SetThrottleWindowSize(kSendWindow);
+  uint64_t point_length =
       bob.ec_->GetSerializeLength();  // 获取点的最大序列化长度
 
-  // Receive H(id)^a
-  uint64_t total_length_x = size_x * max_point_length;
-  std::vector<uint8_t> buffer(total_length_x);
-  std::vector<yc::EcPoint> x_points(size_x);
-  auto bufxpoints = ctx->Recv(ctx->PrevRank(), "Receive H(id)^a");
-  YACL_ENFORCE(bufxpoints.size() == int64_t(total_length_x * sizeof(uint8_t)));
-  std::memcpy(buffer.data(), bufxpoints.data(), bufxpoints.size());
-  bob.BuffertoPoints(absl::MakeSpan(x_points), absl::MakeSpan(buffer));
-
   // Send H(id)^b
-  uint64_t total_length_y = y.size() * max_point_length;
-  std::vector<uint8_t> ybuffer(total_length_y);
-  bob.PointstoBuffer(absl::MakeSpan(y_points), absl::MakeSpan(ybuffer));
-  ctx->SendAsync(
-      ctx->NextRank(),
-      yacl::ByteContainerView(ybuffer.data(), total_length_y * sizeof(uint8_t)),
-      "Send H(id)^b");
-
-  std::vector<std::string> x_str(size_x);
-  // x_str = x_points ^ {bob_sk}
-  bob.MaskEcPointsD(absl::MakeSpan(x_points), absl::MakeSpan(x_str));
-
-  std::vector<std::string> y_str(y.size());
-
-  auto bufy_str = ctx->Recv(ctx->PrevRank(), "Receive y_str");
-  YACL_ENFORCE(bufy_str.size() == int64_t(total_length_y * sizeof(uint8_t)));
-  std::vector<uint8_t> maskbuffer(total_length_y);
-  std::memcpy(maskbuffer.data(), bufy_str.data(), bufy_str.size());
-  yacl::parallel_for(0, y.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * max_point_length;
-      y_str[idx] =
-          std::string(reinterpret_cast<const char*>(maskbuffer.data() + offset),
-                      max_point_length);
-    }
+  auto send_y = std::async(std::launch::async, [&] {
+    SendMaskedBatches(y_ctx, bob, y, batch_size, "Send H(id)^b");
   });
-  auto z = GetIntersectionIdx(x_str, y_str);
+
+  if (short_digest) {
+    size_t digest_bits =
+        examples::psi::MaskLength(kStatSecParam, size_x, y.size());
+
+    // Receive H(id)^a, x_digest = digest(H(id)^ab)
+    std::vector<uint128_t> x_digest(size_x);
+    DigestPeerBatches(ctx, bob, batch_size, digest_bits,
+                      absl::MakeSpan(x_digest));
+
+    // Receive the packed y_mask digests
+    std::vector<uint128_t> y_digest(y.size());
+    RecvPackedDigests(y_ctx, y_ctx->PrevRank(), batch_size, digest_bits,
+                      absl::MakeSpan(y_digest));
+    send_y.get();
+    if (spawned_traffic != nullptr) {
+      spawned_traffic->Add(*y_ctx);
+    }
+    auto z = examples::psi::IntersectMasks(x_digest, y_digest);
+    return std::vector<size_t>(z.begin(), z.end());
+  }
+
+  // Receive H(id)^a, x_str = H(id)^ab
+  std::unordered_set<std::string> x_str;
+  x_str.reserve(size_x);
+  size_t x_batch = BatchSize(size_x, batch_size);
+  std::vector<uint8_t> buffer(x_batch * point_length);
+  std::vector<yc::EcPoint> x_points(x_batch);
+  std::vector<std::string> x_masked(x_batch);
+  for (size_t begin = 0; begin < size_x; begin += x_batch) {
+    size_t n = std::min(x_batch, size_x - begin);
+    auto bufxpoints = ctx->Recv(ctx->PrevRank(), "Receive H(id)^a");
+    YACL_ENFORCE(bufxpoints.size() == int64_t(n * point_length));
+    std::memcpy(buffer.data(), bufxpoints.data(), bufxpoints.size());
+    bob.BuffertoPoints(absl::MakeSpan(x_points).subspan(0, n),
+                       absl::MakeSpan(buffer));
+    bob.MaskEcPointsD(absl::MakeSpan(x_points).subspan(0, n),
+                      absl::MakeSpan(x_masked).subspan(0, n));
+    for (size_t idx = 0; idx < n; ++idx) {
+      x_str.insert(std::move(x_masked[idx]));
+    }
+  }
+
+  // Receive y_mask and look it up batch by batch
+  std::vector<size_t> z;
+  size_t y_batch = BatchSize(y.size(), batch_size);
+  for (size_t begin = 0; begin < y.size(); begin += y_batch) {
+    size_t n = std::min(y_batch, y.size() - begin);
+    auto bufy_str = y_ctx->Recv(y_ctx->PrevRank(), "Receive y_str");
+    YACL_ENFORCE(bufy_str.size() == int64_t(n * point_length));
+    for (size_t idx = 0; idx < n; ++idx) {
+      std::string y_str(bufy_str.data<char>() + idx * point_length,
+                        point_length);
+      if (x_str.count(y_str) != 0) {
+        z.push_back(begin + idx);
+      }
+    }
+  }
+  send_y.get();
+  if (spawned_traffic != nullptr) {
+    spawned_traffic->Add(*y_ctx);
+  }
+  return z;
+}
+
+std::vector<size_t> EcdhMultiPartyPsi(
+    const std::shared_ptr<yacl::link::Context>& ctx,
+    std::vector<std::string>& items, const std::vector<size_t>& sizes,
+    size_t batch_size) {
+  size_t world = ctx->WorldSize();
+  size_t self = ctx->Rank();
+  YACL_ENFORCE(world >= 2 && sizes.size() == world);
+  YACL_ENFORCE(sizes[self] == items.size());
+  EcdhPsi party;
+
+  // streams[s] carries the set of rank s around the ring and digests[s] its
+  // final digests to rank 0. Every party spawns them in the same order.
+  std::vector<std::shared_ptr<yacl::link::Context>> streams(world);
+  std::vector<std::shared_ptr<yacl::link::Context>> digest_streams(world);
+  for (size_t s = 0; s < world; ++s) {
+    streams[s] = ctx->Spawn();
+    digest_streams[s] = ctx->Spawn();
+    streams[s]->SetThrottleWindowSize(kSendWindow);
+    digest_streams[s]->SetThrottleWindowSize(kSendWindow);
+  }
+
+  // Rank 0 filters its digests against each of the N - 1 other sets, and a
+  // false collision with any one of them already corrupts the result, for
+  // instance by matching an item that all the remaining sets really hold.
+  // By the union bound, ceil(log2(N - 1)) extra bits keep the total below
+  // 2^-kStatSecParam when every set is bounded by the largest one.
+  size_t max_other = *std::max_element(sizes.begin() + 1, sizes.end());
+  size_t digest_bits = examples::psi::MaskLength(
+      kStatSecParam + yacl::math::Log2Ceil(world - 1), sizes[0], max_other);
+
+  // Rank s masks its own set, every later rank raises it to its key and
+  // passes it on, and rank s - 1 applies the last key and sends digests.
+  // All N sets are in flight at once.
+  std::vector<std::vector<uint128_t>> digests(self == 0 ? world : 0);
+  std::vector<std::future<void>> tasks;
+  for (size_t owner = 0; owner < world; ++owner) {
+    size_t hop = (self + world - owner) % world;
+    if (self == 0) {
+      digests[owner].resize(sizes[owner]);
+    }
+    if (hop == 0) {
+      tasks.push_back(std::async(std::launch::async, [&, owner] {
+        SendMaskedBatches(streams[owner], party, items, batch_size,
+                          "Send H(id)^k");
+      }));
+    } else if (hop + 1 < world) {
+      tasks.push_back(std::async(std::launch::async, [&, owner] {
+        MaskPeerBatches(streams[owner], streams[owner],
+                        streams[owner]->NextRank(), party, sizes[owner],
+                        batch_size, 0);
+      }));
+    } else if (self == 0) {
+      tasks.push_back(std::async(std::launch::async, [&, owner] {
+        DigestPeerBatches(streams[owner], party, batch_size, digest_bits,
+                          absl::MakeSpan(digests[owner]));
+      }));
+    } else {
+      tasks.push_back(std::async(std::launch::async, [&, owner] {
+        MaskPeerBatches(streams[owner], digest_streams[owner], 0, party,
+                        sizes[owner], batch_size, digest_bits);
+      }));
+    }
+    // rank 0 collects the digests of every set it does not finish itself
+    if (self == 0 && owner != 1) {
+      tasks.push_back(std::async(std::launch::async, [&, owner] {
+        RecvPackedDigests(digest_streams[owner], (owner + world - 1) % world,
+                          batch_size, digest_bits,
+                          absl::MakeSpan(digests[owner]));
+      }));
+    }
+  }
+  for (auto& task : tasks) {
+    task.get();
+  }
+  if (self != 0) {
+    return {};
+  }
+
+  // Filter the own digests against every other set in turn.
+  std::vector<size_t> z(sizes[0]);
+  std::iota(z.begin(), z.end(), 0);
+  std::vector<uint128_t> query(digests[0]);
+  for (size_t s = 1; s < world && !z.empty(); ++s) {
+    auto hit = examples::psi::IntersectMasks(digests[s], query);
+    for (size_t i = 0; i < hit.size(); ++i) {
+      z[i] = z[hit[i]];
+      query[i] = query[hit[i]];
+    }
+    z.resize(hit.size());
+    query.resize(hit.size());
+  }
   return z;
 }
 
@@ -152,23 +369,25 @@ void EcdhPsi::MaskEcPointsD(absl::Span<yc::EcPoint> in,
   });
 }
 
-void EcdhPsi::PointstoBuffer(absl::Span<yc::EcPoint> in,
-                             absl::Span<std::uint8_t> buffer) {
+void EcdhPsi::MaskEcPointsDigest(absl::Span<yc::EcPoint> in,
+                                 absl::Span<uint128_t> out) {
+  YACL_ENFORCE(in.size() == out.size());
   yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
     for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      ec_->SerializePoint(in[idx], buffer.data() + offset, 32);
+      out[idx] = yc::Blake3_128(ec_->SerializePoint(ec_->Mul(in[idx], sk_)));
     }
   });
 }
 
+void EcdhPsi::PointstoBuffer(absl::Span<yc::EcPoint> in,
+                             absl::Span<std::uint8_t> buffer) {
+  examples::psi::SerializePoints(*ec_, in, 32,
+                                 buffer.subspan(0, in.size() * 32));
+}
+
 void EcdhPsi::BuffertoPoints(absl::Span<yc::EcPoint> in,
                              absl::Span<std::uint8_t> buffer) {
-  yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      in[idx] =
-          ec_->DeserializePoint(absl::MakeSpan(buffer.data() + offset, 32));
-    }
-  });
+  examples::psi::DeserializePoints(*ec_, buffer.subspan(0, in.size() * 32), 32,
+                                   in);
+  examples::psi::CheckPointsInGroup(*ec_, in);
 }
@@ -17,6 +17,9 @@
 #include <memory>
 #include <vector>
 
+#include "examples/psi/link_traffic.h"
+
+#include "yacl/base/int128.h"
 #include "yacl/crypto/ecc/ec_point.h"
 #include "yacl/crypto/ecc/ecc_spi.h"
 #include "yacl/link/link.h"
@@ -24,6 +27,18 @@
 
 namespace yc = yacl::crypto;
 
+// Points are exchanged in batches of this many elements; 0 sends each set as
+// a single message.
+constexpr size_t kDefaultBatchSize = 1 << 14;
+
+// Number of batches a party may have in flight before it waits for the peer
+// to consume them. Together with the batch size this bounds the memory held
+// by the link.
+constexpr size_t kSendWindow = 4;
+
+// Statistical security parameter for the length of the final digests.
+constexpr size_t kStatSecParam = 40;
+
 class EcdhPsi {
  public:
   EcdhPsi() {
@@ -41,6 +56,11 @@ class EcdhPsi {
 
   void MaskEcPointsD(absl::Span<yc::EcPoint> in, absl::Span<std::string> out);
 
+  // Mask input points with secret key and outputs the 128-bit hash of the
+  // serialized results
+  void MaskEcPointsDigest(absl::Span<yc::EcPoint> in,
+                          absl::Span<uint128_t> out);
+
   void PointstoBuffer(absl::Span<yc::EcPoint> in,
                       absl::Span<std::uint8_t> buffer);
 
@@ -53,8 +73,47 @@ class EcdhPsi {
   std::shared_ptr<yc::EcGroup> ec_;  // ec group
 };
 
-std::vector<size_t> EcdhPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
-                                std::vector<std::string>& y, size_t size_x);
+// The two exponentiation rounds run concurrently, batch by batch: H(x)^a
+// travels on ctx while H(y)^b and H(y)^ba travel on a context spawned from
+// it, so masking a batch overlaps the transmission and the peer's masking of
+// the previous ones. Both parties must use the same batch_size.
+//
+// With short_digest, the doubly-masked points are compared through hashes
+// truncated to MaskLength(kStatSecParam, |x|, |y|) bits instead of full
+// serialized points, which shrinks the last round 3-4x for typical sizes.
+// Both parties must use the same short_digest.
+//
+// The spawned context keeps its own link statistics. If spawned_traffic is
+// not null, its counters are added there on return, so the caller can report
+// them together with those of ctx.
+std::vector<size_t> EcdhPsiRecv(
+    const std::shared_ptr<yacl::link::Context>& ctx,
+    std::vector<std::string>& y, size_t size_x,
+    size_t batch_size = kDefaultBatchSize, bool short_digest = true,
+    examples::psi::LinkTraffic* spawned_traffic = nullptr);
 
 void EcdhPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
-                 std::vector<std::string>& x, size_t size_y);
+                 std::vector<std::string>& x, size_t size_y,
+                 size_t batch_size = kDefaultBatchSize,
+                 bool short_digest = true,
+                 examples::psi::LinkTraffic* spawned_traffic = nullptr);
+
+// N-party PSI on the ring 0 -> 1 -> ... -> N-1 -> 0 of ctx. The set of rank s
+// is masked by s, raised to the key of every following rank in turn, and the
+// last one, rank s - 1, sends truncated digests of the fully masked points
+// to rank 0. The N sets travel concurrently, each on its own spawned
+// context, and every hop, the last one included, streams batches of
+// batch_size points. sizes holds the set size of every rank.
+//
+// Returns, on rank 0, the indices of its items that every party holds, and
+// nothing on the other ranks. All parties must use the same batch_size.
+//
+// Rank 0 receives the fully masked digests of every set, so it learns more
+// than the N-party intersection: which of its items each other party holds,
+// and how large the intersection of any group of the other parties' sets
+// is, by matching their digests against each other. Use it only where that
+// leakage is acceptable.
+std::vector<size_t> EcdhMultiPartyPsi(
+    const std::shared_ptr<yacl::link::Context>& ctx,
+    std::vector<std::string>& items, const std::vector<size_t>& sizes,
+    size_t batch_size = kDefaultBatchSize);
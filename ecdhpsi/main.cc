@@ -34,13 +34,21 @@ int RunEcdhPsi() {
   auto x = CreateRangeItems(0, s_n);
   auto y = CreateRangeItems(3, r_n);
   auto lctxs = yacl::link::test::SetupWorld(2);  // setup network
+  examples::psi::LinkTraffic sender_stats;
+  examples::psi::LinkTraffic receiver_stats;
   auto start_time = std::chrono::high_resolution_clock::now();
-  std::future<void> sender =
-      std::async(std::launch::async, [&] { EcdhPsiSend(lctxs[0], x, r_n); });
-  std::future<std::vector<size_t>> receiver = std::async(
-      std::launch::async, [&] { return EcdhPsiRecv(lctxs[1], y, s_n); });
+  std::future<void> sender = std::async(std::launch::async, [&] {
+    EcdhPsiSend(lctxs[0], x, r_n, kDefaultBatchSize, true, &sender_stats);
+  });
+  std::future<std::vector<size_t>> receiver =
+      std::async(std::launch::async, [&] {
+        return EcdhPsiRecv(lctxs[1], y, s_n, kDefaultBatchSize, true,
+                           &receiver_stats);
+      });
   sender.get();
   auto z = receiver.get();
+  sender_stats.Add(*lctxs[0]);
+  receiver_stats.Add(*lctxs[1]);
   auto end_time = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> duration = end_time - start_time;
   std::cout << "Execution time: " << duration.count() << " seconds"
@@ -50,23 +58,135 @@ int RunEcdhPsi() {
   auto bytesToMB = [](size_t bytes) -> double {
     return static_cast<double>(bytes) / (1024 * 1024);
   };
-  auto sender_stats = lctxs[0]->GetStats();
-  auto receiver_stats = lctxs[1]->GetStats();
-  std::cout << "Sender sent bytes: "
-            << bytesToMB(sender_stats->sent_bytes.load()) << " MB" << std::endl;
-  std::cout << "Sender received bytes: "
-            << bytesToMB(sender_stats->recv_bytes.load()) << " MB" << std::endl;
-  std::cout << "Receiver sent bytes: "
-            << bytesToMB(receiver_stats->sent_bytes.load()) << " MB"
-            << std::endl;
+  std::cout << "Sender sent bytes: " << bytesToMB(sender_stats.sent_bytes)
+            << " MB" << std::endl;
+  std::cout << "Sender received bytes: " << bytesToMB(sender_stats.recv_bytes)
+            << " MB" << std::endl;
+  std::cout << "Receiver sent bytes: " << bytesToMB(receiver_stats.sent_bytes)
+            << " MB" << std::endl;
   std::cout << "Receiver received bytes: "
-            << bytesToMB(receiver_stats->recv_bytes.load()) << " MB"
-            << std::endl;
+            << bytesToMB(receiver_stats.recv_bytes) << " MB" << std::endl;
   std::cout << "Total Communication: "
-            << bytesToMB(receiver_stats->sent_bytes.load()) +
-                   bytesToMB(receiver_stats->recv_bytes.load())
+            << bytesToMB(receiver_stats.sent_bytes) +
+                   bytesToMB(receiver_stats.recv_bytes)
             << " MB" << std::endl;
   return 0;
 }
 
-int main() { RunEcdhPsi(); }
+// End-to-end time over loopback for increasing batch sizes; 0 sends each set
+// in a single message. The link holds at most kSendWindow batches per
+// direction and stream.
+void RunBatchSizeBench() {
+  size_t n = 1 << 18;
+  auto x = CreateRangeItems(0, n);
+  auto y = CreateRangeItems(3, n);
+  std::cout << "batch_size, time (s), in-flight bound (MB), intersection size"
+            << std::endl;
+  for (size_t batch_size : {0, 1 << 10, 1 << 12, 1 << 14, 1 << 16}) {
+    auto lctxs = yacl::link::test::SetupBrpcWorld(2);  // setup network
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::future<void> sender = std::async(std::launch::async, [&] {
+      EcdhPsiSend(lctxs[0], x, n, batch_size);
+    });
+    std::future<std::vector<size_t>> receiver =
+        std::async(std::launch::async, [&] {
+          return EcdhPsiRecv(lctxs[1], y, n, batch_size);
+        });
+    sender.get();
+    auto z = receiver.get();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end_time - start_time;
+    size_t batch = batch_size == 0 ? n : batch_size;
+    double bound_mb = static_cast<double>(kSendWindow * batch * 32) /
+                      (1024 * 1024);
+    std::cout << batch_size << ", " << duration.count() << ", " << bound_mb
+              << ", " << z.size() << std::endl;
+  }
+}
+
+// Bytes of the last round, which the sender sends alone on the spawned
+// context, and end-to-end time with full serialized points against
+// truncated digests.
+void RunDigestBench() {
+  std::cout << "log2(n), full points (MB), digests (MB), full points (s), "
+               "digests (s)"
+            << std::endl;
+  auto bytesToMB = [](size_t bytes) -> double {
+    return static_cast<double>(bytes) / (1024 * 1024);
+  };
+  for (size_t logn : {16, 18, 20}) {
+    size_t n = size_t{1} << logn;
+    auto x = CreateRangeItems(0, n);
+    auto y = CreateRangeItems(3, n);
+    double mb[2];
+    double seconds[2];
+    for (bool short_digest : {false, true}) {
+      auto lctxs = yacl::link::test::SetupWorld(2);  // setup network
+      examples::psi::LinkTraffic last_round;
+      auto start_time = std::chrono::high_resolution_clock::now();
+      std::future<void> sender = std::async(std::launch::async, [&] {
+        EcdhPsiSend(lctxs[0], x, n, kDefaultBatchSize, short_digest,
+                    &last_round);
+      });
+      std::future<std::vector<size_t>> receiver =
+          std::async(std::launch::async, [&] {
+            return EcdhPsiRecv(lctxs[1], y, n, kDefaultBatchSize,
+                               short_digest);
+          });
+      sender.get();
+      auto z = receiver.get();
+      std::chrono::duration<double> duration =
+          std::chrono::high_resolution_clock::now() - start_time;
+      YACL_ENFORCE(z.size() == n - 3);
+      mb[short_digest] = bytesToMB(last_round.sent_bytes);
+      seconds[short_digest] = duration.count();
+    }
+    std::cout << logn << ", " << mb[0] << ", " << mb[1] << ", " << seconds[0]
+              << ", " << seconds[1] << std::endl;
+  }
+}
+
+// End-to-end time of the ring PSI for 3 to 8 parties, party r holding
+// [r, r + n), so N - 1 items of rank 0 are outside the intersection.
+void RunMultiPartyBench() {
+  std::cout << "parties, log2(n), time (s)" << std::endl;
+  size_t logn = 16;
+  size_t n = size_t{1} << logn;
+  for (size_t world = 3; world <= 8; ++world) {
+    std::vector<std::vector<std::string>> items(world);
+    for (size_t r = 0; r < world; ++r) {
+      items[r] = CreateRangeItems(r, n);
+    }
+    std::vector<size_t> sizes(world, n);
+    auto lctxs = yacl::link::test::SetupWorld(world);  // setup network
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::vector<std::future<std::vector<size_t>>> parties;
+    for (size_t r = 0; r < world; ++r) {
+      parties.push_back(std::async(std::launch::async, [&, r] {
+        return EcdhMultiPartyPsi(lctxs[r], items[r], sizes);
+      }));
+    }
+    std::vector<size_t> z;
+    for (size_t r = 0; r < world; ++r) {
+      auto ret = parties[r].get();
+      if (r == 0) {
+        z = std::move(ret);
+      }
+    }
+    std::chrono::duration<double> duration =
+        std::chrono::high_resolution_clock::now() - start_time;
+    YACL_ENFORCE(z.size() == n - (world - 1));
+    for (size_t i = 0; i < z.size(); ++i) {
+      YACL_ENFORCE(z[i] == i + world - 1);
+    }
+    std::cout << world << ", " << logn << ", " << duration.count()
+              << std::endl;
+  }
+}
+
+int main() {
+  RunEcdhPsi();
+  RunBatchSizeBench();
+  RunDigestBench();
+  RunMultiPartyBench();
+}
@@ -21,6 +21,7 @@
 #include "c/blake3.h"
 #include "examples/fastpsi/galois128.h"
 
+#include "yacl/base/exception.h"
 #include "yacl/base/int128.h"
 #include "yacl/utils/parallel.h"
 
@@ -169,4 +170,36 @@ void OKVSBK::Mul(okvs::Galois128 delta_gf128) {
       this->p_[idx] = (delta_gf128 * this->p_[idx]).get<uint128_t>(0);
     }
   });
-}
\ No newline at end of file
+}
+void OKVSBK::ComputeRows(absl::Span<const uint128_t> keys,
+                         absl::Span<int64_t> pos,
+                         absl::Span<uint8_t> rows) const {
+  auto b = this->b_;
+  auto r = this->r_;
+  YACL_ENFORCE(pos.size() == keys.size());
+  YACL_ENFORCE(rows.size() == keys.size() * b);
+  yacl::parallel_for(0, keys.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      std::vector<uint8_t> row = HashToFixedSize(b, keys[idx]);
+      pos[idx] = ((BytesToUint128(row) % r) / 8) << 3;
+      std::memcpy(rows.data() + idx * b, row.data(), b);
+    }
+  });
+}
+
+uint128_t OKVSBK::DecodeRow(const uint8_t* row, int64_t pos,
+                            const uint128_t* p) const {
+  uint128_t res = 0;
+  for (int64_t bb = 0; bb < this->b_; bb++) {
+    // 跳过全零字节
+    if (row[bb] == 0) {
+      continue;
+    }
+    for (int64_t j = 0; j < 8; j++) {
+      if (getBit(row[bb], j)) {
+        res = res ^ p[pos + (bb << 3) + j];
+      }
+    }
+  }
+  return res;
+}
@@ -19,6 +19,7 @@
 #include <cstring>
 #include <vector>
 
+#include "absl/types/span.h"
 #include "examples/fastpsi/galois128.h"
 
 #include "yacl/base/int128.h"
@@ -67,6 +68,13 @@ class OKVSBK {
                     std::vector<uint128_t> p) const;
   void Mul(okvs::Galois128 delta_gf128);
 
+  // 计算每个key的带状行：pos为对齐后的起始位置，rows中每个key占getB()字节
+  void ComputeRows(absl::Span<const uint128_t> keys, absl::Span<int64_t> pos,
+                   absl::Span<uint8_t> rows) const;
+  // 用ComputeRows得到的行对任意长度为m的向量p解码
+  uint128_t DecodeRow(const uint8_t* row, int64_t pos,
+                      const uint128_t* p) const;
+
  private:
   int64_t n_;  // okvs存储的k-v长度
   int64_t m_;  // okvs的实际长度
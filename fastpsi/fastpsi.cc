@@ -12,10 +12,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include "examples/fastpsi/fastpsi.h"
+
+#include <algorithm>
 #include <future>
 #include <vector>
 
 #include "examples/fastpsi/bokvs.h"
+#include "examples/psi/mask_intersection.h"
+#include "examples/psi/mask_packing.h"
 
 #include "yacl/base/int128.h"
 #include "yacl/kernel/algorithms/silent_vole.h"
@@ -34,8 +39,20 @@ std::vector<uint128_t> CreateRangeItems(size_t begin, size_t size) {
 
 std::vector<uint128_t> FastPsiRecv(
     const std::shared_ptr<yacl::link::Context>& ctx,
-    std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs) {
-  uint128_t okvssize = ourokvs.getM();
+    std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs, size_t chunk_size,
+    size_t mask_bits) {
+  size_t okvssize = ourokvs.getM();
+  size_t n = elem_hashes.size();
+  size_t sender_size =
+      DeserializeUint128(ctx->Recv(ctx->PrevRank(), "sender size"));
+  if (chunk_size == 0) {
+    chunk_size = std::max({okvssize, n, sender_size});
+  }
+  if (mask_bits == 0) {
+    mask_bits = examples::psi::MaskLength(kStatSecParam, sender_size, n);
+  }
+  ctx->SendAsync(ctx->NextRank(), yacl::SerializeUint128(mask_bits),
+                 "mask bits");
 
   // VOLE
   const auto codetype = yacl::crypto::CodeType::ExAcc11;
@@ -48,42 +65,67 @@ std::vector<uint128_t> FastPsiRecv(
 
   // Encode
   ourokvs.Encode(elem_hashes, elem_hashes);
-  std::vector<uint128_t> aprime(okvssize);
   volereceiver.get();
 
-  yacl::parallel_for(0, aprime.size(), [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      aprime[idx] = a[idx] ^ ourokvs.p_[idx];
-    }
-  });
-
-  ctx->SendAsync(
-      ctx->NextRank(),
-      yacl::ByteContainerView(aprime.data(), aprime.size() * sizeof(uint128_t)),
-      "Send A' = P+A");
-  std::vector<uint128_t> receivermasks(elem_hashes.size());
-  ourokvs.DecodeOtherP(elem_hashes, receivermasks, c);
-  std::vector<uint128_t> sendermasks(elem_hashes.size());
-  auto buf = ctx->Recv(ctx->PrevRank(), "Receive masks of sender");
-  YACL_ENFORCE(buf.size() == int64_t(elem_hashes.size() * sizeof(uint128_t)));
-  std::memcpy(sendermasks.data(), buf.data(), buf.size());
-  std::vector<uint128_t> intersection_elements;
-  std::mutex intersection_mutex;
-  std::set<uint128_t> seta(receivermasks.begin(), receivermasks.end());
-  yacl::parallel_for(0, sendermasks.size(), [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      if (seta.count(sendermasks[idx]) != 0) {
-        std::lock_guard<std::mutex> lock(intersection_mutex);
-        intersection_elements.push_back(elem_hashes[idx]);
+  // Send A' = P+A chunk by chunk, so the sender can start decoding while the
+  // rest is still being computed and transmitted.
+  std::vector<uint128_t> aprime(chunk_size);
+  for (size_t begin = 0; begin < okvssize; begin += chunk_size) {
+    size_t len = std::min(chunk_size, okvssize - begin);
+    yacl::parallel_for(0, len, [&](int64_t b, int64_t e) {
+      for (int64_t idx = b; idx < e; ++idx) {
+        aprime[idx] = a[begin + idx] ^ ourokvs.p_[begin + idx];
       }
+    });
+    ctx->SendAsync(
+        ctx->NextRank(),
+        yacl::ByteContainerView(aprime.data(), len * sizeof(uint128_t)),
+        "Send A' = P+A");
+  }
+  std::vector<uint128_t> receivermasks(n);
+  ourokvs.DecodeOtherP(elem_hashes, receivermasks, c);
+  examples::psi::TruncateMasks(absl::MakeSpan(receivermasks), mask_bits);
+
+  std::vector<uint128_t> sendermasks(sender_size);
+  for (size_t begin = 0; begin < sender_size; begin += chunk_size) {
+    size_t len = std::min(chunk_size, sender_size - begin);
+    auto buf = ctx->Recv(ctx->PrevRank(), "Receive masks of sender");
+    YACL_ENFORCE(buf.size() ==
+                 int64_t(examples::psi::PackedSize(len, mask_bits)));
+    examples::psi::UnpackMasks(
+        absl::MakeConstSpan(buf.data<uint8_t>(), buf.size()), mask_bits,
+        absl::MakeSpan(sendermasks.data() + begin, len));
+  }
+
+  // The sender streams its masks in decoding order, so the intersection is
+  // taken over the receiver's own items.
+  auto idx = examples::psi::IntersectMasks(sendermasks, receivermasks);
+  std::vector<uint128_t> intersection_elements(idx.size());
+  yacl::parallel_for(0, idx.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      intersection_elements[i] = elem_hashes[idx[i]];
     }
   });
   return intersection_elements;
 }
 
 void FastPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
-                 std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs) {
-  uint128_t okvssize = ourokvs.getM();
+                 std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs,
+                 size_t chunk_size, size_t mask_bits) {
+  size_t okvssize = ourokvs.getM();
+  size_t n = elem_hashes.size();
+  size_t w = ourokvs.getW();
+  size_t rowbytes = w / 8;
+  ctx->SendAsync(ctx->NextRank(), yacl::SerializeUint128(n), "sender size");
+  if (chunk_size == 0) {
+    chunk_size = std::max(okvssize, n);
+  }
+  size_t recv_mask_bits =
+      DeserializeUint128(ctx->Recv(ctx->PrevRank(), "mask bits"));
+  YACL_ENFORCE(mask_bits == 0 || mask_bits == recv_mask_bits,
+               "mask_bits {} does not match the receiver's {}", mask_bits,
+               recv_mask_bits);
+  mask_bits = recv_mask_bits;
   const auto codetype = yacl::crypto::CodeType::ExAcc11;
   std::vector<uint128_t> b(okvssize);
   uint128_t delta = 0;
@@ -92,29 +134,71 @@ void FastPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
     sv_sender.Send(ctx, absl::MakeSpan(b));
     delta = sv_sender.GetDelta();
   });
-  volesender.get();
+
+  // Hashing the OKVS rows does not depend on the VOLE, so do it while the
+  // VOLE is running.
+  std::vector<int64_t> pos(n);
+  std::vector<uint8_t> rows(n * rowbytes);
+  ourokvs.ComputeRows(absl::MakeSpan(elem_hashes), absl::MakeSpan(pos),
+                      absl::MakeSpan(rows));
+
+  // Bucket the items by the A' chunk that completes their band, so each
+  // item can be decoded as soon as that chunk has arrived.
+  size_t num_chunks = (okvssize + chunk_size - 1) / chunk_size;
+  std::vector<size_t> offsets(num_chunks + 1, 0);
+  for (size_t idx = 0; idx < n; ++idx) {
+    offsets[(pos[idx] + w - 1) / chunk_size + 1]++;
+  }
+  for (size_t j = 0; j < num_chunks; ++j) {
+    offsets[j + 1] += offsets[j];
+  }
+  std::vector<size_t> order(n);
+  std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+  for (size_t idx = 0; idx < n; ++idx) {
+    order[fill[(pos[idx] + w - 1) / chunk_size]++] = idx;
+  }
+
+  // Decode(k) = Decode(B) + delta * Decode(A'), so t = Decode(A') + H(x) can
+  // be computed chunk by chunk without waiting for delta.
   std::vector<uint128_t> aprime(okvssize);
-  auto buf = ctx->Recv(ctx->PrevRank(), "Receive A' = P+A");
-  YACL_ENFORCE(buf.size() == int64_t(okvssize * sizeof(uint128_t)));
-  std::memcpy(aprime.data(), buf.data(), buf.size());
+  std::vector<uint128_t> t(n);
+  for (size_t j = 0; j < num_chunks; ++j) {
+    size_t begin = j * chunk_size;
+    size_t len = std::min(chunk_size, okvssize - begin);
+    auto buf = ctx->Recv(ctx->PrevRank(), "Receive A' = P+A");
+    YACL_ENFORCE(buf.size() == int64_t(len * sizeof(uint128_t)));
+    std::memcpy(aprime.data() + begin, buf.data(), buf.size());
+    yacl::parallel_for(offsets[j], offsets[j + 1], [&](int64_t bb, int64_t e) {
+      for (int64_t k = bb; k < e; ++k) {
+        size_t idx = order[k];
+        t[idx] = ourokvs.DecodeRow(rows.data() + idx * rowbytes, pos[idx],
+                                   aprime.data()) ^
+                 elem_hashes[idx];
+      }
+    });
+  }
+  volesender.get();
   okvs::Galois128 delta_gf128(delta);
-  std::vector<uint128_t> k(okvssize);
-  yacl::parallel_for(0, okvssize, [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      k[idx] = b[idx] ^ (delta_gf128 * aprime[idx]).get<uint128_t>(0);
-    }
-  });
-  std::vector<uint128_t> sendermasks(elem_hashes.size());
-  ourokvs.DecodeOtherP(elem_hashes, sendermasks, k);
-  yacl::parallel_for(0, elem_hashes.size(), [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      sendermasks[idx] =
-          sendermasks[idx] ^ (delta_gf128 * elem_hashes[idx]).get<uint128_t>(0);
-    }
-  });
-  ctx->SendAsync(
-      ctx->NextRank(),
-      yacl::ByteContainerView(sendermasks.data(),
-                              sendermasks.size() * sizeof(uint128_t)),
-      "Send masks of sender");
+
+  // Masks are produced and sent in bucket order; chunk i is computed while
+  // chunk i-1 is on the wire.
+  std::vector<uint128_t> sendermasks(chunk_size);
+  std::vector<uint8_t> packed;
+  for (size_t begin = 0; begin < n; begin += chunk_size) {
+    size_t len = std::min(chunk_size, n - begin);
+    yacl::parallel_for(0, len, [&](int64_t bb, int64_t e) {
+      for (int64_t k = bb; k < e; ++k) {
+        size_t idx = order[begin + k];
+        sendermasks[k] = ourokvs.DecodeRow(rows.data() + idx * rowbytes,
+                                           pos[idx], b.data()) ^
+                         (delta_gf128 * t[idx]).get<uint128_t>(0);
+      }
+    });
+    packed.resize(examples::psi::PackedSize(len, mask_bits));
+    examples::psi::PackMasks(absl::MakeConstSpan(sendermasks.data(), len),
+                             mask_bits, absl::MakeSpan(packed));
+    ctx->SendAsync(ctx->NextRank(),
+                   yacl::ByteContainerView(packed.data(), packed.size()),
+                   "Send masks of sender");
+  }
 }
@@ -20,11 +20,24 @@
 #include "yacl/base/int128.h"
 #include "yacl/kernel/algorithms/silent_vole.h"
 
+// A' = P+A and the sender masks are streamed in chunks of this many
+// uint128_t elements. A chunk size of 0 sends each vector as a single message.
+constexpr size_t kDefaultChunkSize = 1 << 16;
+
+// Statistical security parameter used to derive the default mask length.
+constexpr size_t kStatSecParam = 40;
+
+// mask_bits is the length of the sender masks on the wire. The receiver
+// fixes it, deriving it from kStatSecParam and both set sizes when 0, and
+// sends it to the sender. A nonzero mask_bits on the sender must match.
+
 std::vector<uint128_t> FastPsiRecv(
     const std::shared_ptr<yacl::link::Context>& ctx,
-    std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs);
+    std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs,
+    size_t chunk_size = kDefaultChunkSize, size_t mask_bits = 0);
 
 void FastPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
-                 std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs);
+                 std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs,
+                 size_t chunk_size = kDefaultChunkSize, size_t mask_bits = 0);
 
 std::vector<uint128_t> CreateRangeItems(size_t begin, size_t size);
\ No newline at end of file
@@ -12,17 +12,25 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <chrono>
+#include <cstring>
+#include <future>
 #include <iostream>
+#include <mutex>
 #include <ostream>
+#include <set>
 #include <vector>
 
 #include "examples/fastpsi/bokvs.h"
 #include "examples/fastpsi/fastpsi.h"
+#include "examples/psi/mask_packing.h"
 
 #include "yacl/base/int128.h"
+#include "yacl/kernel/algorithms/silent_vole.h"
 #include "yacl/link/test_util.h"
+#include "yacl/utils/parallel.h"
 
-int main() {
+void RunFastPsi() {
   size_t n = 1 << 10;
   size_t w = 512;
   double e = 1.01;
@@ -78,3 +86,181 @@ int main() {
                    bytesToMB(receiver_stats->recv_bytes.load())
             << " MB" << std::endl;
 }
+
+// The protocol as it was before A' and the masks were streamed: the sender
+// waits for the VOLE and the whole of A', then decodes and sends all 128-bit
+// masks at once. Kept here only as the baseline for RunChunkSizeBench.
+std::vector<uint128_t> UnchunkedFastPsiRecv(
+    const std::shared_ptr<yacl::link::Context>& ctx,
+    std::vector<uint128_t>& elem_hashes, OKVSBK ourokvs) {
+  uint128_t okvssize = ourokvs.getM();
+
+  const auto codetype = yacl::crypto::CodeType::ExAcc11;
+  std::vector<uint128_t> a(okvssize);
+  std::vector<uint128_t> c(okvssize);
+  auto volereceiver = std::async([&] {
+    auto sv_receiver = yacl::crypto::SilentVoleReceiver(codetype);
+    sv_receiver.Recv(ctx, absl::MakeSpan(a), absl::MakeSpan(c));
+  });
+
+  ourokvs.Encode(elem_hashes, elem_hashes);
+  std::vector<uint128_t> aprime(okvssize);
+  volereceiver.get();
+
+  yacl::parallel_for(0, aprime.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      aprime[idx] = a[idx] ^ ourokvs.p_[idx];
+    }
+  });
+
+  ctx->SendAsync(
+      ctx->NextRank(),
+      yacl::ByteContainerView(aprime.data(), aprime.size() * sizeof(uint128_t)),
+      "Send A' = P+A");
+  std::vector<uint128_t> receivermasks(elem_hashes.size());
+  ourokvs.DecodeOtherP(elem_hashes, receivermasks, c);
+  std::vector<uint128_t> sendermasks(elem_hashes.size());
+  auto buf = ctx->Recv(ctx->PrevRank(), "Receive masks of sender");
+  YACL_ENFORCE(buf.size() == int64_t(elem_hashes.size() * sizeof(uint128_t)));
+  std::memcpy(sendermasks.data(), buf.data(), buf.size());
+  std::vector<uint128_t> intersection_elements;
+  std::mutex intersection_mutex;
+  std::set<uint128_t> seta(receivermasks.begin(), receivermasks.end());
+  yacl::parallel_for(0, sendermasks.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      if (seta.count(sendermasks[idx]) != 0) {
+        std::lock_guard<std::mutex> lock(intersection_mutex);
+        intersection_elements.push_back(elem_hashes[idx]);
+      }
+    }
+  });
+  return intersection_elements;
+}
+
+void UnchunkedFastPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
+                          std::vector<uint128_t>& elem_hashes,
+                          OKVSBK ourokvs) {
+  uint128_t okvssize = ourokvs.getM();
+  const auto codetype = yacl::crypto::CodeType::ExAcc11;
+  std::vector<uint128_t> b(okvssize);
+  uint128_t delta = 0;
+  auto volesender = std::async([&] {
+    auto sv_sender = yacl::crypto::SilentVoleSender(codetype);
+    sv_sender.Send(ctx, absl::MakeSpan(b));
+    delta = sv_sender.GetDelta();
+  });
+  volesender.get();
+  std::vector<uint128_t> aprime(okvssize);
+  auto buf = ctx->Recv(ctx->PrevRank(), "Receive A' = P+A");
+  YACL_ENFORCE(buf.size() == int64_t(okvssize * sizeof(uint128_t)));
+  std::memcpy(aprime.data(), buf.data(), buf.size());
+  okvs::Galois128 delta_gf128(delta);
+  std::vector<uint128_t> k(okvssize);
+  yacl::parallel_for(0, okvssize, [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      k[idx] = b[idx] ^ (delta_gf128 * aprime[idx]).get<uint128_t>(0);
+    }
+  });
+  std::vector<uint128_t> sendermasks(elem_hashes.size());
+  ourokvs.DecodeOtherP(elem_hashes, sendermasks, k);
+  yacl::parallel_for(0, elem_hashes.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t idx = begin; idx < end; ++idx) {
+      sendermasks[idx] =
+          sendermasks[idx] ^ (delta_gf128 * elem_hashes[idx]).get<uint128_t>(0);
+    }
+  });
+  ctx->SendAsync(
+      ctx->NextRank(),
+      yacl::ByteContainerView(sendermasks.data(),
+                              sendermasks.size() * sizeof(uint128_t)),
+      "Send masks of sender");
+}
+
+// End-to-end latency over a loopback brpc link of the unchunked protocol
+// above against the streamed one for several chunk sizes. Chunk size 0 runs
+// the streamed code path with A' and the masks sent as one message each.
+void RunChunkSizeBench() {
+  size_t n = 1 << 20;
+  size_t w = 512;
+  double e = 1.01;
+  OKVSBK ourokvs(n, w, e);
+  std::vector<uint128_t> items_a = CreateRangeItems(0, n);
+  std::vector<uint128_t> items_b = CreateRangeItems(0, n);
+  std::cout << "chunk_size, time (s), intersection size" << std::endl;
+  {
+    auto lctxs = yacl::link::test::SetupBrpcWorld(2);  // setup network
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::future<void> fastpsi_sender = std::async(std::launch::async, [&] {
+      UnchunkedFastPsiSend(lctxs[0], items_a, ourokvs);
+    });
+    std::future<std::vector<uint128_t>> fastpsi_receiver =
+        std::async(std::launch::async, [&] {
+          return UnchunkedFastPsiRecv(lctxs[1], items_b, ourokvs);
+        });
+    fastpsi_sender.get();
+    auto psi_result = fastpsi_receiver.get();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end_time - start_time;
+    std::cout << "unchunked, " << duration.count() << ", "
+              << psi_result.size() << std::endl;
+  }
+  for (size_t chunk_size : {0, 1 << 12, 1 << 14, 1 << 16, 1 << 18}) {
+    auto lctxs = yacl::link::test::SetupBrpcWorld(2);  // setup network
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::future<void> fastpsi_sender = std::async(std::launch::async, [&] {
+      FastPsiSend(lctxs[0], items_a, ourokvs, chunk_size);
+    });
+    std::future<std::vector<uint128_t>> fastpsi_receiver =
+        std::async(std::launch::async, [&] {
+          return FastPsiRecv(lctxs[1], items_b, ourokvs, chunk_size);
+        });
+    fastpsi_sender.get();
+    auto psi_result = fastpsi_receiver.get();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end_time - start_time;
+    std::cout << chunk_size << ", " << duration.count() << ", "
+              << psi_result.size() << std::endl;
+  }
+}
+
+// Sender-to-receiver traffic with full 128-bit masks against the default
+// mask length derived from kStatSecParam and the set sizes.
+void RunMaskLengthBench() {
+  size_t n = 1 << 20;
+  size_t w = 512;
+  double e = 1.01;
+  OKVSBK ourokvs(n, w, e);
+  std::vector<uint128_t> items_a = CreateRangeItems(0, n);
+  std::vector<uint128_t> items_b = CreateRangeItems(0, n);
+  std::cout << "mask_bits, sender sent (MB), receiver sent (MB), "
+               "intersection size"
+            << std::endl;
+  for (size_t mask_bits : {size_t{128}, size_t{0}}) {
+    auto lctxs = yacl::link::test::SetupWorld(2);  // setup network
+    std::future<void> fastpsi_sender = std::async(std::launch::async, [&] {
+      FastPsiSend(lctxs[0], items_a, ourokvs, kDefaultChunkSize, mask_bits);
+    });
+    std::future<std::vector<uint128_t>> fastpsi_receiver =
+        std::async(std::launch::async, [&] {
+          return FastPsiRecv(lctxs[1], items_b, ourokvs, kDefaultChunkSize,
+                             mask_bits);
+        });
+    fastpsi_sender.get();
+    auto psi_result = fastpsi_receiver.get();
+    auto bytesToMB = [](size_t bytes) -> double {
+      return static_cast<double>(bytes) / (1024 * 1024);
+    };
+    std::cout << (mask_bits == 0
+                      ? examples::psi::MaskLength(kStatSecParam, n, n)
+                      : mask_bits)
+              << ", " << bytesToMB(lctxs[0]->GetStats()->sent_bytes.load())
+              << ", " << bytesToMB(lctxs[1]->GetStats()->sent_bytes.load())
+              << ", " << psi_result.size() << std::endl;
+  }
+}
+
+int main() {
+  RunFastPsi();
+  RunChunkSizeBench();
+  RunMaskLengthBench();
+}
@@ -18,6 +18,8 @@
 #include <memory>
 #include <vector>
 
+#include "examples/psi/point_batch.h"
+
 #include "yacl/base/int128.h"
 #include "yacl/crypto/ecc/ec_point.h"
 #include "yacl/crypto/ecc/ecc_spi.h"
@@ -108,23 +110,15 @@ yacl::dynamic_bitset<uint128_t> OsuRecv(
 
 void Shuffle::PointstoBuffer(absl::Span<yc::EcPoint> in,
                              absl::Span<std::uint8_t> buffer) {
-  yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      ec_->SerializePoint(in[idx], buffer.data() + offset, 32);
-    }
-  });
+  examples::psi::SerializePoints(*ec_, in, 32,
+                                 buffer.subspan(0, in.size() * 32));
 }
 
 void Shuffle::BuffertoPoints(absl::Span<yc::EcPoint> in,
                              absl::Span<std::uint8_t> buffer) {
-  yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      in[idx] =
-          ec_->DeserializePoint(absl::MakeSpan(buffer.data() + offset, 32));
-    }
-  });
+  examples::psi::DeserializePoints(*ec_, buffer.subspan(0, in.size() * 32), 32,
+                                   in);
+  examples::psi::CheckPointsInGroup(*ec_, in);
 }
 
 void Shuffle::EncInputs(absl::Span<uint128_t> in, absl::Span<yc::EcPoint> c1,
@@ -0,0 +1,211 @@
+#include <chrono>
+#include <ctime>
+#include <future>
+#include <iostream>
+#include <vector>
+
+#include "examples/kkrt/kkrt_psi.h"
+#include "examples/kkrt/oprf_table.h"
+#include "examples/kkrt/psi_data_batch.h"
+
+#include "yacl/base/exception.h"
+#include "yacl/base/int128.h"
+#include "yacl/crypto/hash/hash_utils.h"
+#include "yacl/link/test_util.h"
+#include "yacl/utils/parallel.h"
+
+std::vector<uint128_t> CreateRangeItems(size_t begin, size_t size) {
+  std::vector<uint128_t> ret(size);
+  for (size_t i = 0; i < size; i++) {
+    auto hash = yacl::crypto::Blake3(std::to_string(begin + i));
+    memcpy(&ret[i], hash.data(), sizeof(uint128_t));
+  }
+  return ret;
+}
+
+// Wall and process CPU time of a full run. Both parties run in this process,
+// so the CPU time covers the two of them and the encoding workers; a sender
+// that polls for corrections shows up as CPU time above the wall time of a
+// single busy core.
+void RunCpuTimeBench() {
+  std::cout << "log2(n), wall time (s), cpu time (s)" << std::endl;
+  for (size_t logn : {16, 18, 20}) {
+    size_t n = size_t{1} << logn;
+    auto alice_items = CreateRangeItems(1, n);
+    auto bob_items = CreateRangeItems(2, n);
+    auto contexts = yacl::link::test::SetupWorld(2);
+    std::clock_t start_cpu = std::clock();
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::future<void> kkrt_psi_sender = std::async(
+        std::launch::async, [&] { KkrtPsiSend(contexts[0], alice_items); });
+    std::future<std::vector<std::size_t>> kkrt_psi_receiver =
+        std::async(std::launch::async,
+                   [&] { return KkrtPsiRecv(contexts[1], bob_items); });
+    kkrt_psi_sender.get();
+    auto results_b = kkrt_psi_receiver.get();
+    std::chrono::duration<double> duration =
+        std::chrono::high_resolution_clock::now() - start_time;
+    double cpu_seconds =
+        static_cast<double>(std::clock() - start_cpu) / CLOCKS_PER_SEC;
+    YACL_ENFORCE(results_b.size() == n - 1);
+    std::cout << logn << ", " << duration.count() << ", " << cpu_seconds
+              << std::endl;
+  }
+}
+
+// Receiver latency, from the start until its result is ready, and the bytes
+// of the receiver's OPRF lookup table, its largest allocation. The table is
+// sized as the receiver sizes it: 64-bit keys when the encodings fit, and
+// 128-bit keys otherwise.
+void RunReceiverBench() {
+  std::cout << "log2(n), receiver time (s), oprf table (MB)" << std::endl;
+  for (size_t logn : {16, 18, 20}) {
+    size_t n = size_t{1} << logn;
+    auto alice_items = CreateRangeItems(1, n);
+    auto bob_items = CreateRangeItems(2, n);
+    auto contexts = yacl::link::test::SetupWorld(2);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::future<void> kkrt_psi_sender = std::async(
+        std::launch::async, [&] { KkrtPsiSend(contexts[0], alice_items); });
+    std::future<std::vector<std::size_t>> kkrt_psi_receiver =
+        std::async(std::launch::async,
+                   [&] { return KkrtPsiRecv(contexts[1], bob_items); });
+    auto results_b = kkrt_psi_receiver.get();
+    std::chrono::duration<double> duration =
+        std::chrono::high_resolution_clock::now() - start_time;
+    kkrt_psi_sender.get();
+    YACL_ENFORCE(results_b.size() == n - 1);
+    size_t encode_size = (40 + 2 * logn + 7) / 8;
+    size_t table_bytes = encode_size <= sizeof(uint64_t)
+                             ? OprfTable<uint64_t>(n).ByteSize()
+                             : OprfTable<uint128_t>(n).ByteSize();
+    std::cout << logn << ", " << duration.count() << ", "
+              << static_cast<double>(table_bytes) / (1 << 20) << std::endl;
+  }
+}
+
+// Serializes and parses the sender encodings of n items in batches of 1024
+// items, as the sender and receiver do, and reports the time per batch and
+// the throughput over the encoding bytes. The 16-byte header is the only
+// per-batch overhead on the wire.
+void RunBatchFormatBench() {
+  std::cout << "log2(n), batches, time per batch (us), throughput (GB/s)"
+            << std::endl;
+  constexpr size_t kBatchItems = 1024;
+  constexpr size_t kHashNum = 3;
+  for (size_t logn : {20, 22, 24}) {
+    size_t n = size_t{1} << logn;
+    size_t encode_size = (40 + 2 * logn + 7) / 8;
+    std::vector<uint8_t> encodings(n * kHashNum * encode_size, 0x5a);
+    size_t num_batches = 0;
+    uint64_t checksum = 0;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < n; i += kBatchItems, ++num_batches) {
+      size_t item_num = std::min(kBatchItems, n - i);
+      PsiDataBatch batch;
+      batch.item_num = item_num;
+      batch.batch_index = num_batches;
+      batch.is_last_batch = (i + item_num == n);
+      batch.flatten_bytes = absl::MakeConstSpan(
+          encodings.data() + i * kHashNum * encode_size,
+          item_num * kHashNum * encode_size);
+      yacl::Buffer buf = batch.Serialize();
+      PsiDataBatch parsed = PsiDataBatch::Deserialize(buf);
+      checksum += parsed.item_num + parsed.flatten_bytes.back();
+    }
+    std::chrono::duration<double> duration =
+        std::chrono::high_resolution_clock::now() - start_time;
+    YACL_ENFORCE(checksum == n + num_batches * 0x5a);
+    std::cout << logn << ", " << num_batches << ", "
+              << duration.count() * 1e6 / num_batches << ", "
+              << encodings.size() / duration.count() / 1e9 << std::endl;
+  }
+}
+
+// Communication and runtime of 2^18 items for several cuckoo hash counts and
+// stash sizes. Fewer hashes need more receiver bins, so more OT corrections,
+// but fewer sender encodings; each stash slot adds one sender encoding per
+// item.
+void RunCuckooConfigBench() {
+  std::cout << "hashes, stash, receiver sent (MB), sender sent (MB), time (s)"
+            << std::endl;
+  auto bytesToMB = [](size_t bytes) -> double {
+    return static_cast<double>(bytes) / (1024 * 1024);
+  };
+  size_t n = size_t{1} << 18;
+  auto alice_items = CreateRangeItems(1, n);
+  auto bob_items = CreateRangeItems(2, n);
+  std::vector<std::pair<size_t, size_t>> configs = {
+      {2, 4}, {2, 8}, {3, 0}, {3, 4}, {4, 0}, {4, 2}};
+  for (auto [hash_num, stash_size] : configs) {
+    KkrtPsiOptions options = GetDefaultKkrtPsiOptions();
+    options.cuckoo_hash_num = hash_num;
+    options.stash_size = stash_size;
+    auto contexts = yacl::link::test::SetupWorld(2);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::future<void> kkrt_psi_sender =
+        std::async(std::launch::async, [&] {
+          auto ot_recv = GetKkrtOtSenderOptions(contexts[0], 512);
+          KkrtPsiSend(contexts[0], options, ot_recv, alice_items);
+        });
+    std::future<std::vector<std::size_t>> kkrt_psi_receiver =
+        std::async(std::launch::async, [&] {
+          auto ot_send = GetKkrtOtReceiverOptions(contexts[1], 512);
+          return KkrtPsiRecv(contexts[1], options, ot_send, bob_items);
+        });
+    kkrt_psi_sender.get();
+    auto results_b = kkrt_psi_receiver.get();
+    std::chrono::duration<double> duration =
+        std::chrono::high_resolution_clock::now() - start_time;
+    YACL_ENFORCE(results_b.size() == n - 1);
+    std::cout << hash_num << ", " << stash_size << ", "
+              << bytesToMB(contexts[1]->GetStats()->sent_bytes.load()) << ", "
+              << bytesToMB(contexts[0]->GetStats()->sent_bytes.load()) << ", "
+              << duration.count() << std::endl;
+  }
+}
+
+// End-to-end time of 2^20 items with both parties capped at 1 to 32
+// encoding tasks. Tasks beyond the size of the yacl pool add nothing.
+void RunThreadScalingBench() {
+  std::cout << "pool threads: " << yacl::get_num_threads() << std::endl;
+  std::cout << "num_threads, time (s), speedup" << std::endl;
+  size_t n = size_t{1} << 20;
+  auto alice_items = CreateRangeItems(1, n);
+  auto bob_items = CreateRangeItems(2, n);
+  double base_seconds = 0;
+  for (size_t num_threads : {1, 2, 4, 8, 16, 32}) {
+    KkrtPsiOptions options = GetDefaultKkrtPsiOptions();
+    options.num_threads = num_threads;
+    auto contexts = yacl::link::test::SetupWorld(2);
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::future<void> kkrt_psi_sender =
+        std::async(std::launch::async, [&] {
+          auto ot_recv = GetKkrtOtSenderOptions(contexts[0], 512);
+          KkrtPsiSend(contexts[0], options, ot_recv, alice_items);
+        });
+    std::future<std::vector<std::size_t>> kkrt_psi_receiver =
+        std::async(std::launch::async, [&] {
+          auto ot_send = GetKkrtOtReceiverOptions(contexts[1], 512);
+          return KkrtPsiRecv(contexts[1], options, ot_send, bob_items);
+        });
+    kkrt_psi_sender.get();
+    auto results_b = kkrt_psi_receiver.get();
+    std::chrono::duration<double> duration =
+        std::chrono::high_resolution_clock::now() - start_time;
+    YACL_ENFORCE(results_b.size() == n - 1);
+    if (num_threads == 1) {
+      base_seconds = duration.count();
+    }
+    std::cout << num_threads << ", " << duration.count() << ", "
+              << base_seconds / duration.count() << std::endl;
+  }
+}
+
+int main() {
+  RunReceiverBench();
+  RunCpuTimeBench();
+  RunBatchFormatBench();
+  RunCuckooConfigBench();
+  RunThreadScalingBench();
+}
@@ -1,9 +1,17 @@
 #include "examples/kkrt/kkrt_psi.h"
 
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
 #include <cstring>
+#include <deque>
+#include <functional>
 #include <future>
+#include <mutex>
 #include <numeric>
+#include <random>
 #include <string>
 
 #include "absl/strings/escaping.h"
@@ -11,6 +19,9 @@
 #include "openssl/rand.h"
 #include "spdlog/spdlog.h"
 
+#include "examples/kkrt/oprf_table.h"
+#include "examples/kkrt/psi_data_batch.h"
+
 #include "yacl/base/exception.h"
 #include "yacl/crypto/hash/hash_utils.h"
 #include "yacl/crypto/rand/rand.h"
@@ -19,73 +30,23 @@
 #include "yacl/kernel/algorithms/iknp_ote.h"
 #include "yacl/kernel/algorithms/kkrt_ote.h"
 #include "yacl/utils/cuckoo_index.h"
+#include "yacl/utils/parallel.h"
 
-struct PsiDataBatch {
-  uint32_t item_num = 0;
-  std::string flatten_bytes;
-  int32_t batch_index = 0;
-  bool is_last_batch = false;
-  std::string type;
-
-  // 序列化为字符串形式
-  std::string Serialize() const {
-    std::string serialized_data;
-
-    // 序列化 item_num
-    serialized_data.append(reinterpret_cast<const char*>(&item_num),
-                           sizeof(item_num));
-
-    // 序列化 flatten_bytes 的长度和内容
-    uint32_t flatten_bytes_size = flatten_bytes.size();
-    serialized_data.append(reinterpret_cast<const char*>(&flatten_bytes_size),
-                           sizeof(flatten_bytes_size));
-    serialized_data.append(flatten_bytes);
-
-    // 序列化 is_last_batch
-    serialized_data.append(reinterpret_cast<const char*>(&is_last_batch),
-                           sizeof(is_last_batch));
-
-    return serialized_data;
-  }
-
-  // 反序列化 Buffer 数据
-  static PsiDataBatch Deserialize(const yacl::Buffer& buf) {
-    PsiDataBatch batch;
-    size_t offset = 0;
-
-    // 将 Buffer 数据复制到 std::vector<uint8_t>
-    std::vector<uint8_t> buffer_data(buf.size());
-    std::memcpy(buffer_data.data(), buf.data(), buf.size());
-
-    // 将 std::vector<uint8_t> 转换为 std::string
-    std::string serialized_data(buffer_data.begin(), buffer_data.end());
-
-    // 反序列化 item_num
-    std::memcpy(&batch.item_num, serialized_data.data() + offset,
-                sizeof(batch.item_num));
-    offset += sizeof(batch.item_num);
-
-    // 反序列化 flatten_bytes 的长度和内容
-    uint32_t flatten_bytes_size;
-    std::memcpy(&flatten_bytes_size, serialized_data.data() + offset,
-                sizeof(flatten_bytes_size));
-    offset += sizeof(flatten_bytes_size);
-
-    batch.flatten_bytes = serialized_data.substr(offset, flatten_bytes_size);
-    offset += flatten_bytes_size;
-
-    // 反序列化 is_last_batch
-    std::memcpy(&batch.is_last_batch, serialized_data.data() + offset,
-                sizeof(batch.is_last_batch));
+namespace {
 
-    return batch;
-  }
+// One sender encoding: item_idx under the OPRF of bin_idx, written to slot
+// pos of the encode buffer.
+struct EncodeTask {
+  uint32_t bin_idx;
+  uint32_t item_idx;
+  uint32_t pos;
 };
 
 // constexpr size_t kPsiDataBatchSize = 1 << 10;
 constexpr size_t kPsiDataBatchSize = 1024;
 constexpr size_t kStashSize = 0;
 constexpr size_t kCuckooHashNum = 3;
+constexpr size_t kMaxCuckooHashNum = 4;
 constexpr size_t kStatSecParam = 40;
 constexpr size_t kKkrtOtBatchSize = (65535 / 4 / 16 * 0.8);  // NOLINT
 
@@ -120,13 +81,36 @@ size_t ExchangeSetSize(const std::shared_ptr<yacl::link::Context>& link_ctx,
 // stat_sec_param = 40, data_size 2^40 encode size is 15
 // data_size > 2^40, use encode size 16,
 // hash collision probability will > 2^-40
-inline uint64_t KkrtEncodeSize(uint64_t stat_sec_param, uint128_t self_size,
-                               uint128_t peer_size) {
+uint64_t KkrtEncodeSize(uint64_t stat_sec_param, uint128_t self_size,
+                        uint128_t peer_size) {
+  // bytes for stat_sec_param + log2(self * peer) bits, rounded up
   uint64_t encode_size =
-      (stat_sec_param + std::log2l(self_size * peer_size) + 7) / 8;
+      std::ceil((stat_sec_param + std::log2l(self_size * peer_size)) / 8);
   return std::min(encode_size, static_cast<uint64_t>(sizeof(uint128_t)));
 }
 
+// Runs fn over [begin, end) on at most num_threads tasks of the yacl pool,
+// or on the whole pool if num_threads is 0.
+void ParallelFor(int64_t begin, int64_t end, size_t num_threads,
+                 const std::function<void(int64_t, int64_t)>& fn) {
+  if (num_threads == 0) {
+    yacl::parallel_for(begin, end, fn);
+    return;
+  }
+  int64_t grain = (end - begin + num_threads - 1) / num_threads;
+  yacl::parallel_for(begin, end, std::max<int64_t>(grain, 1), fn);
+}
+
+// 2 to 4 cuckoo hashes, any stash size; both parties must agree on them.
+void CheckCuckooOptions(const KkrtPsiOptions& kkrt_psi_options) {
+  YACL_ENFORCE(kkrt_psi_options.cuckoo_hash_num >= 2 &&
+                   kkrt_psi_options.cuckoo_hash_num <= kMaxCuckooHashNum,
+               "cuckoo hash num {} not in [2, {}]",
+               kkrt_psi_options.cuckoo_hash_num, kMaxCuckooHashNum);
+}
+
+}  // namespace
+
 KkrtPsiOptions GetDefaultKkrtPsiOptions() {
   KkrtPsiOptions kkrt_psi_options;
 
@@ -165,9 +149,7 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
                  const KkrtPsiOptions& kkrt_psi_options,  // with kkrt options
                  yacl::crypto::OtRecvStore& ot_recv,
                  const std::vector<uint128_t>& items_hash) {
-  YACL_ENFORCE((kkrt_psi_options.cuckoo_hash_num == 3) &&
-                   (kkrt_psi_options.stash_size == 0),
-               "now only support cuckoo HashNum = 3 , stash size = 0");
+  CheckCuckooOptions(kkrt_psi_options);
   YACL_ENFORCE(ot_recv.Size() == 512,
                "now only support baseRecvOption block size 512");
 
@@ -184,33 +166,17 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
   yacl::CuckooIndex::Options option = yacl::CuckooIndex::SelectParams(
       peer_size, kkrt_psi_options.stash_size, kkrt_psi_options.cuckoo_hash_num);
   size_t num_bins = option.NumBins();
+  // OPRF num_bins + s belongs to stash slot s of the receiver
+  size_t num_ots = num_bins + kkrt_psi_options.stash_size;
+  // every item has one encoding per hash and one per stash slot
+  size_t encode_num =
+      kkrt_psi_options.cuckoo_hash_num + kkrt_psi_options.stash_size;
 
   yacl::crypto::KkrtOtExtSender sender;
-  sender.Init(link_ctx, ot_recv, option.NumBins());
+  sender.Init(link_ctx, ot_recv, num_ots);
   sender.SetBatchSize(kKkrtOtBatchSize);
   uint64_t kkrtOtBatchSize = sender.GetBatchSize();
 
-  std::atomic<uint64_t> recv_idx(0);
-  auto f_recv_corrections = std::async([&]() {
-    // while there are more corrections for be received
-    size_t correction_batch_idx = 0;
-    while (recv_idx < num_bins) {
-      // compute the  size of the current step and the end index
-      size_t current_step_size = std::min(kkrtOtBatchSize, num_bins - recv_idx);
-
-      // receive the corrections.
-      auto current_correction_buf = link_ctx->Recv(
-          link_ctx->NextRank(),
-          fmt::format("KKRT:PSI:ThrottleControlReceiver recv batch_count:{}",
-                      correction_batch_idx));
-      sender.SetCorrection(current_correction_buf, current_step_size);
-      correction_batch_idx++;
-
-      // notify the other thread that the corrections have arrived
-      recv_idx.fetch_add(current_step_size, std::memory_order_release);
-    }
-  });
-
   // permute sender input data
   std::vector<size_t> input_permute;
   std::vector<size_t> input_permute_inv;
@@ -229,119 +195,147 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
     input_permute_inv[input_permute[i]] = i;
   }
 
-  // hash bucketing
-  yacl::Buffer encode_buf(self_size * kkrt_psi_options.cuckoo_hash_num *
-                          encode_size);
-  std::vector<std::array<uint64_t, kCuckooHashNum>> bin_indices;
-  bin_indices.resize(self_size);
-
-  for (size_t i = 0; i < self_size; ++i) {
-    yacl::CuckooIndex::HashRoom itemHash(items_hash[i]);
-    uint64_t bin_idx0 = itemHash.GetHash(0) % num_bins;
-    uint64_t bin_idx1 = itemHash.GetHash(1) % num_bins;
-    uint64_t bin_idx2 = itemHash.GetHash(2) % num_bins;
-
-    bin_indices[i][0] = bin_idx0;
-    // check collision
-    uint8_t c01 = (bin_idx0 == bin_idx1) ? 1 : 0;
-    bin_indices[i][1] = bin_idx1 | (c01 * static_cast<uint64_t>(-1));
-    uint8_t c02 = (bin_idx0 == bin_idx2 || bin_idx1 == bin_idx2) ? 1 : 0;
-    bin_indices[i][2] = bin_idx2 | (c02 * static_cast<uint64_t>(-1));
-    if (c01 == 1) {
-      uint8_t* encode_pos =
-          encode_buf.data<uint8_t>() +
-          (input_permute_inv[i] * kkrt_psi_options.cuckoo_hash_num + 1) *
-              encode_size;
-      prg.Fill(absl::MakeSpan(encode_pos, encode_size));
+  // hash bucketing: encodings whose bin repeats an earlier hash of the same
+  // item are random, the others are grouped by the correction batch of their
+  // bin so that each batch can be encoded as soon as it arrives.
+  yacl::Buffer encode_buf(self_size * encode_num * encode_size);
+  size_t num_ot_batches = (num_ots + kkrtOtBatchSize - 1) / kkrtOtBatchSize;
+  std::vector<EncodeTask> encode_tasks;
+  std::vector<size_t> batch_offsets(num_ot_batches + 1, 0);
+  YACL_ENFORCE(num_ots <= UINT32_MAX && self_size * encode_num <= UINT32_MAX,
+               "too many items for 32-bit encode tasks");
+  {
+    std::vector<std::array<uint64_t, kMaxCuckooHashNum>> bin_indices(
+        self_size);
+    for (size_t i = 0; i < self_size; ++i) {
+      yacl::CuckooIndex::HashRoom itemHash(items_hash[i]);
+      auto& bin_idx = bin_indices[i];
+      for (size_t h = 0; h < kkrt_psi_options.cuckoo_hash_num; ++h) {
+        bin_idx[h] = itemHash.GetHash(h) % num_bins;
+        if (std::find(bin_idx.begin(), bin_idx.begin() + h, bin_idx[h]) !=
+            bin_idx.begin() + h) {
+          size_t pos = input_permute_inv[i] * encode_num + h;
+          prg.Fill(absl::MakeSpan(
+              encode_buf.data<uint8_t>() + pos * encode_size, encode_size));
+          bin_idx[h] = static_cast<uint64_t>(-1);
+        } else {
+          ++batch_offsets[bin_idx[h] / kkrtOtBatchSize + 1];
+        }
+      }
     }
-    if (c02 == 1) {
-      uint8_t* encode_pos =
-          encode_buf.data<uint8_t>() +
-          (input_permute_inv[i] * kkrt_psi_options.cuckoo_hash_num + 2) *
-              encode_size;
-      prg.Fill(absl::MakeSpan(encode_pos, encode_size));
+    for (size_t s = 0; s < kkrt_psi_options.stash_size; ++s) {
+      batch_offsets[(num_bins + s) / kkrtOtBatchSize + 1] += self_size;
+    }
+    std::partial_sum(batch_offsets.begin(), batch_offsets.end(),
+                     batch_offsets.begin());
+
+    encode_tasks.resize(batch_offsets.back());
+    std::vector<size_t> fill(batch_offsets.begin(), batch_offsets.end() - 1);
+    for (size_t i = 0; i < self_size; ++i) {
+      for (size_t h = 0; h < kkrt_psi_options.cuckoo_hash_num; ++h) {
+        uint64_t b_idx = bin_indices[i][h];
+        if (b_idx != static_cast<uint64_t>(-1)) {
+          encode_tasks[fill[b_idx / kkrtOtBatchSize]++] = {
+              static_cast<uint32_t>(b_idx), static_cast<uint32_t>(i),
+              static_cast<uint32_t>(input_permute_inv[i] * encode_num + h)};
+        }
+      }
+      for (size_t s = 0; s < kkrt_psi_options.stash_size; ++s) {
+        size_t h = kkrt_psi_options.cuckoo_hash_num + s;
+        encode_tasks[fill[(num_bins + s) / kkrtOtBatchSize]++] = {
+            static_cast<uint32_t>(num_bins + s), static_cast<uint32_t>(i),
+            static_cast<uint32_t>(input_permute_inv[i] * encode_num + h)};
+      }
     }
   }
 
-  uint64_t t = 0;
-  uint64_t r = 0;
-  // while not all the corrections have been received, try to encode any that
-  // we can
-  // TODO(shuyan.ycf): this implementation wastes cpus if the networking is
-  // slow (Due to spin logics). Better use synchronization primitives.
-  while (r != num_bins) {
-    // process things in steps
-    for (uint64_t j = 0; j < kkrtOtBatchSize; ++j) {
-      // lets check a random item to see if it can be encoded. If so,
-      // we will write this item's encodings in the myMaskBuff at position i.
-      auto input_idx = input_permute[t];
-
-      // for each hash function, try to encode the item.
-      for (uint64_t h = 0; h < kkrt_psi_options.cuckoo_hash_num; ++h) {
-        uint64_t b_idx = bin_indices[input_idx][h];
-
-        // if the bin index is less than r, then we have received
-        // the correction and can encode it
-        if (b_idx < r) {
-          // write the encoding into encode_buf at position  t, h
-          uint8_t* encoding =
-              encode_buf.data<uint8_t>() +
-              (t * kkrt_psi_options.cuckoo_hash_num + h) * encode_size;
-          sender.Encode(b_idx, items_hash[input_idx], encoding, encode_size);
-
-          // make this location as already been encoded
-          bin_indices[input_idx][h] = -1;
+  // The receiving thread queues correction batches and the encoder sleeps
+  // until one is available instead of polling.
+  std::mutex corrections_mutex;
+  std::condition_variable corrections_cv;
+  std::deque<yacl::Buffer> corrections;
+  bool recv_finished = false;
+  auto finish_recv = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(corrections_mutex);
+      recv_finished = true;
+    }
+    corrections_cv.notify_one();
+  };
+  auto f_recv_corrections = std::async(std::launch::async, [&]() {
+    try {
+      for (size_t batch_idx = 0; batch_idx < num_ot_batches; ++batch_idx) {
+        auto current_correction_buf = link_ctx->Recv(
+            link_ctx->NextRank(),
+            fmt::format("KKRT:PSI:ThrottleControlReceiver recv batch_count:{}",
+                        batch_idx));
+        {
+          std::lock_guard<std::mutex> lock(corrections_mutex);
+          corrections.push_back(std::move(current_correction_buf));
         }
+        corrections_cv.notify_one();
       }
+    } catch (...) {
+      finish_recv();
+      throw;
+    }
+    finish_recv();
+  });
 
-      // wrap around the input looking for items that we can encode
-      t = (t + 1) % self_size;
+  // Apply every correction batch queued so far, then encode all items whose
+  // bins they cover in parallel; the tasks of consecutive batches are
+  // contiguous.
+  size_t applied_batches = 0;
+  while (applied_batches < num_ot_batches) {
+    std::deque<yacl::Buffer> arrived;
+    {
+      std::unique_lock<std::mutex> lock(corrections_mutex);
+      corrections_cv.wait(
+          lock, [&] { return !corrections.empty() || recv_finished; });
+      if (corrections.empty()) {
+        break;
+      }
+      std::swap(arrived, corrections);
+    }
+    size_t first_batch = applied_batches;
+    for (const auto& current_correction_buf : arrived) {
+      size_t current_step_size = std::min(
+          kkrtOtBatchSize, num_ots - applied_batches * kkrtOtBatchSize);
+      sender.SetCorrection(current_correction_buf, current_step_size);
+      ++applied_batches;
     }
 
-    // after stepSize attempts to encode items, lets see if more
-    // corrections have arrived.
-    r = recv_idx.load(std::memory_order_acquire);
+    ParallelFor(
+        batch_offsets[first_batch], batch_offsets[applied_batches],
+        kkrt_psi_options.num_threads, [&](int64_t begin, int64_t end) {
+          for (int64_t k = begin; k < end; ++k) {
+            const auto& task = encode_tasks[k];
+            sender.Encode(task.bin_idx, items_hash[task.item_idx],
+                          encode_buf.data<uint8_t>() + task.pos * encode_size,
+                          encode_size);
+          }
+        });
   }
 
   // Join receiving thread and throw exceptions if any thing is wrong.
   f_recv_corrections.get();
 
   // encoding buffer
+  int32_t batch_index = 0;
   for (size_t i = 0; i < self_size;) {
     size_t curr_step_item_num =
         std::min(kkrt_psi_options.psi_batch_size, self_size - i);
-    size_t curr_step_encode_num =
-        curr_step_item_num * kkrt_psi_options.cuckoo_hash_num;
+    size_t curr_step_encode_num = curr_step_item_num * encode_num;
 
     PsiDataBatch batch;
-    batch.flatten_bytes.resize(encode_size * curr_step_encode_num);
-    uint8_t* encoding = encode_buf.data<uint8_t>() +
-                        (i * kkrt_psi_options.cuckoo_hash_num) * encode_size;
-    for (size_t j = 0; j < curr_step_item_num; ++j) {
-      auto input_idx = input_permute[i + j];
-
-      for (size_t k = 0; k < kkrt_psi_options.cuckoo_hash_num; k++) {
-        uint64_t b_idx = bin_indices[input_idx][k];
-
-        if (b_idx != static_cast<uint64_t>(-1)) {
-          sender.Encode(b_idx, items_hash[input_idx], encoding, encode_size);
-        }
-        encoding += encode_size;
-      }
-    }
-
     batch.item_num = curr_step_item_num;
-    batch.is_last_batch = false;
-
-    encoding = encode_buf.data<uint8_t>() +
-               (i * kkrt_psi_options.cuckoo_hash_num) * encode_size;
-    memcpy(batch.flatten_bytes.data(), encoding,
-           encode_size * curr_step_encode_num);
+    batch.batch_index = batch_index++;
+    batch.flatten_bytes = absl::MakeConstSpan(
+        encode_buf.data<uint8_t>() + i * encode_num * encode_size,
+        encode_size * curr_step_encode_num);
 
     i += curr_step_item_num;
-    if (i == self_size) {
-      batch.is_last_batch = true;
-    }
+    batch.is_last_batch = (i == self_size);
 
     link_ctx->SendAsyncThrottled(
         link_ctx->NextRank(), batch.Serialize(),
@@ -354,51 +348,45 @@ void KkrtPsiSend(const std::shared_ptr<yacl::link::Context>& link_ctx,
                                fmt::format("KKRT:PSI:Finished"));
 }
 
-std::vector<std::size_t> KkrtPsiRecv(
-    const std::shared_ptr<yacl::link::Context>& link_ctx,
-    const KkrtPsiOptions& kkrt_psi_options,  // with kkrt options
-    yacl::crypto::OtSendStore& ot_send,
-    const std::vector<uint128_t>& items_hash) {
-  YACL_ENFORCE((kkrt_psi_options.cuckoo_hash_num == 3) &&
-                   (kkrt_psi_options.stash_size == 0),
-               "now only support cuckoo HashNum = 3 , stash size = 0");
-
-  YACL_ENFORCE(ot_send.Size() == 512,
-               "now only support yacl::OtSendStore block size 512");
+namespace {
 
+// Encodes the receiver bins and stash, sends the corrections and looks the
+// sender encodings up in an OprfTable keyed by Key, or against the single
+// item of their stash slot. Returns the indices of the receiver items that
+// were matched.
+template <typename Key>
+std::vector<std::size_t> KkrtPsiRecvOprf(
+    const std::shared_ptr<yacl::link::Context>& link_ctx,
+    const KkrtPsiOptions& kkrt_psi_options,
+    const yacl::CuckooIndex& cuckoo_index,
+    yacl::crypto::KkrtOtExtReceiver& receiver,
+    const std::vector<uint128_t>& items_hash, uint64_t encode_size) {
   std::vector<std::size_t> ret_intersection;
-
-  size_t self_size = items_hash.size();
-  size_t peer_size = ExchangeSetSize(link_ctx, self_size);
-
-  YACL_ENFORCE((peer_size > 0) && (!items_hash.empty()),
-               "item size need not zero, mine={}, peer={}", self_size,
-               peer_size);
-
-  yacl::CuckooIndex::Options option = yacl::CuckooIndex::SelectParams(
-      self_size, kkrt_psi_options.stash_size, kkrt_psi_options.cuckoo_hash_num);
-  yacl::CuckooIndex cuckoo_index(option);
-  cuckoo_index.Insert(absl::MakeSpan(items_hash));
-  YACL_ENFORCE(cuckoo_index.stash().empty(), "stash size not 0");
-  size_t kkrt_ot_num = cuckoo_index.bins().size();
-
-  yacl::crypto::KkrtOtExtReceiver receiver;
-  receiver.Init(link_ctx, ot_send, kkrt_ot_num);
-  receiver.SetBatchSize(kkrt_psi_options.ot_batch_size);
+  size_t num_bins = cuckoo_index.bins().size();
+  size_t kkrt_ot_num = num_bins + kkrt_psi_options.stash_size;
   uint64_t kkrt_ot_batch_size = receiver.GetBatchSize();
+  OprfTable<Key> oprf_encode_table(items_hash.size());
 
-  std::array<std::unordered_map<std::string, size_t>, kCuckooHashNum>
-      oprf_encode_map;
-  for (size_t i = 0; i < kCuckooHashNum; i++) {
-    oprf_encode_map[i].reserve(kkrt_ot_num);
+  // stash slot s holds stash_items[s], if any, under OPRF num_bins + s
+  std::vector<uint64_t> stash_items;
+  for (const auto& bin : cuckoo_index.stash()) {
+    if (!bin.IsEmpty()) {
+      stash_items.push_back(bin.InputIdx());
+    }
   }
-  uint64_t encode_size =
-      KkrtEncodeSize(kkrt_psi_options.stat_sec_param, self_size,
-                     peer_size);  // by byte
+  YACL_ENFORCE(stash_items.size() <= kkrt_psi_options.stash_size,
+               "{} items in a stash of {}", stash_items.size(),
+               kkrt_psi_options.stash_size);
+  std::vector<Key> stash_keys(stash_items.size());
 
   // encoding prf & send correction
-  auto ck_bins = cuckoo_index.bins();
-  std::string encode_str(encode_size, '\0');
+  // The bins of a batch are encoded in parallel, each into its own row of
+  // batch_keys, and only the table inserts run serially.
+  const auto& ck_bins = cuckoo_index.bins();
+  constexpr uint8_t kNoKey = 0xff;
+  std::vector<std::array<uint8_t, sizeof(uint128_t)>> batch_keys(
+      kkrt_ot_batch_size);
+  std::vector<uint8_t> batch_hash_idx(kkrt_ot_batch_size);
   const size_t ot_num_batch =
       (kkrt_ot_num + kkrt_ot_batch_size - 1) / kkrt_ot_batch_size;
   for (size_t batch_idx = 0; batch_idx < ot_num_batch; ++batch_idx) {
@@ -406,20 +394,39 @@ std::vector<std::size_t> KkrtPsiRecv(
         kkrt_ot_num - batch_idx * kkrt_ot_batch_size, kkrt_ot_batch_size);
 
     size_t batch_start = batch_idx * kkrt_ot_batch_size;
+    auto encode = [&](int64_t begin, int64_t end) {
+      for (int64_t i = begin; i < end; ++i) {
+        size_t current_idx = batch_start + i;
+        auto encode_bytes = absl::MakeSpan(batch_keys[i].data(), encode_size);
+        batch_hash_idx[i] = kNoKey;
+        if (current_idx >= num_bins) {
+          size_t s = current_idx - num_bins;
+          if (s < stash_items.size()) {
+            receiver.Encode(current_idx, items_hash[stash_items[s]],
+                            encode_bytes);
+          } else {
+            receiver.ZeroEncode(current_idx);
+          }
+        } else if (ck_bins[current_idx].IsEmpty()) {
+          receiver.ZeroEncode(current_idx);
+        } else {
+          uint128_t input_item = items_hash[ck_bins[current_idx].InputIdx()];
+          receiver.Encode(current_idx, input_item, encode_bytes);
+          batch_hash_idx[i] = cuckoo_index.MinCollidingHashIdx(current_idx);
+        }
+      }
+    };
+    ParallelFor(0, num_this_batch, kkrt_psi_options.num_threads, encode);
+
     for (size_t i = 0; i < num_this_batch; ++i) {
       size_t current_idx = batch_start + i;
-      if (ck_bins[current_idx].IsEmpty()) {
-        receiver.ZeroEncode(current_idx);
-      } else {
-        uint128_t input_item = items_hash[ck_bins[current_idx].InputIdx()];
-        receiver.Encode(
-            current_idx, input_item,
-            absl::Span<uint8_t>(reinterpret_cast<uint8_t*>(encode_str.data()),
-                                encode_size));
-
-        uint8_t min_hash_idx = cuckoo_index.MinCollidingHashIdx(current_idx);
-        oprf_encode_map[min_hash_idx].emplace(encode_str,
-                                              ck_bins[current_idx].InputIdx());
+      Key key = OprfTable<Key>::Load(batch_keys[i].data(), encode_size);
+      if (batch_hash_idx[i] != kNoKey) {
+        oprf_encode_table.Insert(key, batch_hash_idx[i],
+                                 ck_bins[current_idx].InputIdx());
+      } else if (current_idx >= num_bins &&
+                 current_idx - num_bins < stash_items.size()) {
+        stash_keys[current_idx - num_bins] = key;
       }
     }
     auto send_buf = receiver.ShiftCorrection(num_this_batch);
@@ -428,40 +435,113 @@ std::vector<std::size_t> KkrtPsiRecv(
         fmt::format("KKRT_PSI:sendCorrection:{}", batch_idx));
   }
 
+  size_t encode_num =
+      kkrt_psi_options.cuckoo_hash_num + kkrt_psi_options.stash_size;
   size_t batch_count = 0;
+  std::vector<uint32_t> found;
   while (true) {
     // Receive sender prf encode.
-    PsiDataBatch batch = PsiDataBatch::Deserialize(link_ctx->Recv(
+    auto batch_buf = link_ctx->Recv(
         link_ctx->NextRank(),
         fmt::format("KKRT:PSI:RECEIVE:Receive sender prf encode:{}",
-                    batch_count)));
+                    batch_count));
+    PsiDataBatch batch = PsiDataBatch::Deserialize(batch_buf);
+    YACL_ENFORCE_EQ(batch.batch_index, static_cast<int32_t>(batch_count));
     batch_count++;
 
     const bool is_last_batch = batch.is_last_batch;
 
     size_t curr_step_item_num = batch.item_num;
-    size_t curr_step_encode_num =
-        curr_step_item_num * kkrt_psi_options.cuckoo_hash_num;
+    size_t curr_step_encode_num = curr_step_item_num * encode_num;
     YACL_ENFORCE_EQ(batch.flatten_bytes.size(),
                     (curr_step_encode_num * encode_size));
 
-    for (size_t i = 0; i < curr_step_item_num; ++i) {
-      for (size_t j = 0; j < kkrt_psi_options.cuckoo_hash_num; ++j) {
-        std::string encode_sub_str = batch.flatten_bytes.substr(
-            (i * kkrt_psi_options.cuckoo_hash_num + j) * encode_size,
-            encode_size);
-
-        auto it = oprf_encode_map[j].find(encode_sub_str);
-        if (it != oprf_encode_map[j].end()) {
-          ret_intersection.emplace_back(it->second);
+    // encoding k of the batch was made with hash k % encode_num, or with
+    // the OPRF of stash slot k % encode_num - cuckoo_hash_num
+    const uint8_t* encodings = batch.flatten_bytes.data();
+    found.resize(curr_step_encode_num);
+    auto probe = [&](int64_t begin, int64_t end) {
+      for (int64_t k = begin; k < end; ++k) {
+        Key key =
+            OprfTable<Key>::Load(encodings + k * encode_size, encode_size);
+        size_t h = k % encode_num;
+        if (h < kkrt_psi_options.cuckoo_hash_num) {
+          found[k] = oprf_encode_table.Find(key, h);
+        } else {
+          size_t s = h - kkrt_psi_options.cuckoo_hash_num;
+          found[k] = (s < stash_keys.size() && stash_keys[s] == key)
+                         ? static_cast<uint32_t>(stash_items[s])
+                         : OprfTable<Key>::kNotFound;
         }
       }
+    };
+    ParallelFor(0, curr_step_encode_num, kkrt_psi_options.num_threads, probe);
+    for (uint32_t item_idx : found) {
+      if (item_idx != OprfTable<Key>::kNotFound) {
+        ret_intersection.emplace_back(item_idx);
+      }
     }
 
     if (is_last_batch) {
       break;
     }
   }
+  return ret_intersection;
+}
+
+}  // namespace
+
+std::vector<std::size_t> KkrtPsiRecv(
+    const std::shared_ptr<yacl::link::Context>& link_ctx,
+    const KkrtPsiOptions& kkrt_psi_options,  // with kkrt options
+    yacl::crypto::OtSendStore& ot_send,
+    const std::vector<uint128_t>& items_hash) {
+  CheckCuckooOptions(kkrt_psi_options);
+
+  YACL_ENFORCE(ot_send.Size() == 512,
+               "now only support yacl::OtSendStore block size 512");
+
+  std::vector<std::size_t> ret_intersection;
+
+  size_t self_size = items_hash.size();
+  size_t peer_size = ExchangeSetSize(link_ctx, self_size);
+
+  YACL_ENFORCE((peer_size > 0) && (!items_hash.empty()),
+               "item size need not zero, mine={}, peer={}", self_size,
+               peer_size);
+
+  yacl::CuckooIndex::Options option = yacl::CuckooIndex::SelectParams(
+      self_size, kkrt_psi_options.stash_size, kkrt_psi_options.cuckoo_hash_num);
+  yacl::CuckooIndex cuckoo_index(option);
+  cuckoo_index.Insert(absl::MakeSpan(items_hash));
+  size_t kkrt_ot_num =
+      cuckoo_index.bins().size() + kkrt_psi_options.stash_size;
+
+  yacl::crypto::KkrtOtExtReceiver receiver;
+  receiver.Init(link_ctx, ot_send, kkrt_ot_num);
+  receiver.SetBatchSize(kkrt_psi_options.ot_batch_size);
+
+  uint64_t encode_size =
+      KkrtEncodeSize(kkrt_psi_options.stat_sec_param, self_size,
+                     peer_size);  // by byte
+  YACL_ENFORCE(encode_size * 8 >= kkrt_psi_options.stat_sec_param +
+                                     std::log2l(self_size) +
+                                     std::log2l(peer_size),
+               "{} byte encodings are too short for {} bits of statistical "
+               "security with {} x {} items",
+               encode_size, kkrt_psi_options.stat_sec_param, self_size,
+               peer_size);
+
+  // 64-bit keys whenever the encodings fit, 128-bit ones otherwise
+  if (encode_size <= sizeof(uint64_t)) {
+    ret_intersection = KkrtPsiRecvOprf<uint64_t>(
+        link_ctx, kkrt_psi_options, cuckoo_index, receiver, items_hash,
+        encode_size);
+  } else {
+    ret_intersection = KkrtPsiRecvOprf<uint128_t>(
+        link_ctx, kkrt_psi_options, cuckoo_index, receiver, items_hash,
+        encode_size);
+  }
 
   link_ctx->Recv(link_ctx->NextRank(),
                  fmt::format("KKRT:PSI:Wait Sender Finished"));
@@ -17,13 +17,19 @@ struct KkrtPsiOptions {
   // batch size the sender used to send oprf encode
   size_t psi_batch_size = 128;
 
-  // cuckoo hash parameter
-  // now use stashless setting
-  // stash_size = 0  cuckoo_hash_num =3
+  // cuckoo hash parameter, defaults to the stashless 3-hash setting
+  // cuckoo_hash_num in [2, 4]: fewer hashes mean more receiver bins (OTs)
+  // but fewer sender encodings per item
+  // stash_size: every stash slot is one extra OT, and the sender sends one
+  // extra encoding per item for it
   // use stat_sec_param = 40
   size_t cuckoo_hash_num = 3;
   size_t stash_size = 0;
   size_t stat_sec_param = 40;
+
+  // upper bound on the parallel tasks that encode sender items and receiver
+  // bins, 0 uses every thread of the yacl pool
+  size_t num_threads = 0;
 };
 
 yacl::crypto::OtRecvStore GetKkrtOtSenderOptions(
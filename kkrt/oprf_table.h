@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "yacl/base/exception.h"
+#include "yacl/base/int128.h"
+
+// Open-addressing map from truncated OPRF encodings to receiver items.
+//
+// A key is the encode_size byte OPRF output of a bin, loaded into a 64- or
+// 128-bit integer. The outputs are uniformly random, so the low bits of the
+// key pick the home slot directly. Every entry also keeps the cuckoo hash
+// index its item was placed with, and a lookup has to match both. Keys and
+// (hash index, item) words live in separate arrays, so a 128-bit slot takes
+// 20 bytes instead of a padded 32.
+template <typename Key>
+class OprfTable {
+ public:
+  static constexpr uint32_t kNotFound = static_cast<uint32_t>(-1);
+  static constexpr uint32_t kMaxHashNum = 4;
+  static constexpr uint32_t kMaxItems = (uint32_t{1} << 30) - 1;
+
+  explicit OprfTable(size_t num_keys) {
+    YACL_ENFORCE(num_keys < kMaxItems);
+    size_t capacity = 16;
+    while (capacity < 2 * num_keys) {
+      capacity <<= 1;
+    }
+    keys_.resize(capacity);
+    values_.resize(capacity, kEmpty);
+    mask_ = capacity - 1;
+  }
+
+  static Key Load(const uint8_t* encoding, size_t encode_size) {
+    YACL_ENFORCE(encode_size <= sizeof(Key));
+    Key key = 0;
+    std::memcpy(&key, encoding, encode_size);
+    return key;
+  }
+
+  // Keeps the first item if the same key is inserted twice.
+  void Insert(Key key, uint8_t hash_idx, uint32_t item_idx) {
+    YACL_ENFORCE(hash_idx < kMaxHashNum && item_idx < kMaxItems);
+    YACL_ENFORCE(2 * (size_ + 1) <= keys_.size(), "oprf table is full");
+    size_t slot = Slot(key, hash_idx);
+    if (values_[slot] == kEmpty) {
+      keys_[slot] = key;
+      values_[slot] = (uint32_t{hash_idx} << 30) | item_idx;
+      ++size_;
+    }
+  }
+
+  uint32_t Find(Key key, uint8_t hash_idx) const {
+    uint32_t value = values_[Slot(key, hash_idx)];
+    return value == kEmpty ? kNotFound : value & kMaxItems;
+  }
+
+  size_t size() const { return size_; }
+
+  // Bytes held by the key and value arrays.
+  size_t ByteSize() const {
+    return keys_.size() * sizeof(Key) + values_.size() * sizeof(uint32_t);
+  }
+
+ private:
+  // items stay below kMaxItems, so all ones marks an empty slot
+  static constexpr uint32_t kEmpty = static_cast<uint32_t>(-1);
+
+  // the slot holding (key, hash_idx), or the empty slot ending its probe run
+  size_t Slot(Key key, uint8_t hash_idx) const {
+    size_t slot = static_cast<uint64_t>(key) & mask_;
+    while (values_[slot] != kEmpty &&
+           (keys_[slot] != key || (values_[slot] >> 30) != hash_idx)) {
+      slot = (slot + 1) & mask_;
+    }
+    return slot;
+  }
+
+  std::vector<Key> keys_;
+  std::vector<uint32_t> values_;
+  size_t mask_ = 0;
+  size_t size_ = 0;
+};
@@ -0,0 +1,95 @@
+#include "examples/kkrt/oprf_table.h"
+
+#include <cstdint>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "yacl/base/int128.h"
+
+template <typename Key>
+class OprfTableTest : public ::testing::Test {};
+
+// distinct for distinct i, with every low bit varying
+template <typename Key>
+Key TestKey(uint32_t i) {
+  return Key(uint64_t{i} * 0x9e3779b97f4a7c15ULL);
+}
+
+using KeyTypes = ::testing::Types<uint64_t, uint128_t>;
+TYPED_TEST_SUITE(OprfTableTest, KeyTypes);
+
+TYPED_TEST(OprfTableTest, FindsInsertedItems) {
+  using Key = TypeParam;
+  size_t n = 1000;
+  OprfTable<Key> table(n);
+  for (uint32_t i = 0; i < n; ++i) {
+    table.Insert(TestKey<Key>(i), i % OprfTable<Key>::kMaxHashNum, i);
+  }
+  EXPECT_EQ(table.size(), n);
+  for (uint32_t i = 0; i < n; ++i) {
+    Key key = TestKey<Key>(i);
+    EXPECT_EQ(table.Find(key, i % OprfTable<Key>::kMaxHashNum), i);
+    // the same key under another hash index is a different entry
+    EXPECT_EQ(table.Find(key, (i + 1) % OprfTable<Key>::kMaxHashNum),
+              OprfTable<Key>::kNotFound);
+  }
+  EXPECT_EQ(table.Find(TestKey<Key>(n), 0), OprfTable<Key>::kNotFound);
+}
+
+TYPED_TEST(OprfTableTest, ProbesPastEqualLowBits) {
+  using Key = TypeParam;
+  OprfTable<Key> table(8);
+  // all four keys share their home slot
+  std::vector<Key> keys = {Key(1) << 40, Key(2) << 40, Key(3) << 40,
+                           Key(4) << 40};
+  for (uint32_t i = 0; i < keys.size(); ++i) {
+    table.Insert(keys[i], 0, i);
+  }
+  for (uint32_t i = 0; i < keys.size(); ++i) {
+    EXPECT_EQ(table.Find(keys[i], 0), i);
+  }
+  EXPECT_EQ(table.Find(Key(5) << 40, 0), OprfTable<Key>::kNotFound);
+}
+
+TYPED_TEST(OprfTableTest, KeepsFirstDuplicate) {
+  using Key = TypeParam;
+  OprfTable<Key> table(4);
+  table.Insert(Key(42), 1, 7);
+  table.Insert(Key(42), 1, 9);
+  EXPECT_EQ(table.size(), 1);
+  EXPECT_EQ(table.Find(Key(42), 1), 7);
+}
+
+TYPED_TEST(OprfTableTest, RejectsInsertPastHalfFull) {
+  using Key = TypeParam;
+  // num_keys 3 rounds up to the 16 slot minimum, which takes 8 keys
+  OprfTable<Key> table(3);
+  for (uint32_t i = 0; i < 8; ++i) {
+    table.Insert(Key(i), 0, i);
+  }
+  EXPECT_ANY_THROW(table.Insert(Key(8), 0, 8));
+}
+
+TYPED_TEST(OprfTableTest, RejectsOutOfRangeIndices) {
+  using Key = TypeParam;
+  OprfTable<Key> table(4);
+  EXPECT_ANY_THROW(table.Insert(Key(1), OprfTable<Key>::kMaxHashNum, 0));
+  EXPECT_ANY_THROW(table.Insert(Key(1), 0, OprfTable<Key>::kMaxItems));
+  EXPECT_EQ(table.size(), 0);
+}
+
+TYPED_TEST(OprfTableTest, ByteSizeCountsBothArrays) {
+  using Key = TypeParam;
+  // 2^10 keys need 2^11 slots
+  OprfTable<Key> table(1 << 10);
+  EXPECT_EQ(table.ByteSize(), (size_t{1} << 11) * (sizeof(Key) + 4));
+}
+
+TEST(OprfTableLoadTest, ReadsLittleEndianPrefix) {
+  std::vector<uint8_t> encoding = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+  EXPECT_EQ(OprfTable<uint64_t>::Load(encoding.data(), 3), 0x030201U);
+  EXPECT_EQ(OprfTable<uint128_t>::Load(encoding.data(), 10),
+            yacl::MakeUint128(0x0a09, 0x0807060504030201ULL));
+  EXPECT_ANY_THROW(OprfTable<uint64_t>::Load(encoding.data(), 9));
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#include "absl/types/span.h"
+
+#include "yacl/base/buffer.h"
+#include "yacl/base/exception.h"
+
+// One batch of sender OPRF encodings on the wire: a fixed 16-byte header
+// followed by the encodings.
+//
+// Serialize writes the header and copies the encodings straight into the
+// buffer that is handed to the link, and Deserialize parses a received
+// buffer in place, so flatten_bytes of a parsed batch points into it.
+struct PsiDataBatch {
+  uint32_t item_num = 0;
+  int32_t batch_index = 0;
+  bool is_last_batch = false;
+  absl::Span<const uint8_t> flatten_bytes;
+
+  struct Header {
+    uint32_t item_num;
+    int32_t batch_index;
+    uint32_t flatten_bytes_size;
+    uint32_t is_last_batch;
+  };
+  static constexpr size_t kHeaderSize = sizeof(Header);
+
+  yacl::Buffer Serialize() const {
+    Header header{item_num, batch_index,
+                  static_cast<uint32_t>(flatten_bytes.size()),
+                  is_last_batch ? 1U : 0U};
+    yacl::Buffer buf(static_cast<int64_t>(kHeaderSize + flatten_bytes.size()));
+    std::memcpy(buf.data<uint8_t>(), &header, kHeaderSize);
+    if (!flatten_bytes.empty()) {
+      std::memcpy(buf.data<uint8_t>() + kHeaderSize, flatten_bytes.data(),
+                  flatten_bytes.size());
+    }
+    return buf;
+  }
+
+  // The batch is valid only as long as buf.
+  static PsiDataBatch Deserialize(const yacl::Buffer& buf) {
+    YACL_ENFORCE(buf.size() >= static_cast<int64_t>(kHeaderSize),
+                 "psi data batch of {} bytes has no header", buf.size());
+    Header header;
+    std::memcpy(&header, buf.data<uint8_t>(), kHeaderSize);
+    YACL_ENFORCE(buf.size() == static_cast<int64_t>(kHeaderSize +
+                                                    header.flatten_bytes_size),
+                 "psi data batch of {} bytes, header says {}", buf.size(),
+                 kHeaderSize + header.flatten_bytes_size);
+
+    PsiDataBatch batch;
+    batch.item_num = header.item_num;
+    batch.batch_index = header.batch_index;
+    batch.is_last_batch = header.is_last_batch != 0;
+    batch.flatten_bytes = absl::MakeConstSpan(
+        buf.data<uint8_t>() + kHeaderSize, header.flatten_bytes_size);
+    return batch;
+  }
+  static PsiDataBatch Deserialize(yacl::Buffer&& buf) = delete;
+};
@@ -0,0 +1,93 @@
+#include "examples/kkrt/psi_data_batch.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+TEST(PsiDataBatchTest, HeaderLayout) {
+  std::vector<uint8_t> encodings = {0xaa, 0xbb, 0xcc};
+  PsiDataBatch batch;
+  batch.item_num = 0x01020304;
+  batch.batch_index = -2;
+  batch.is_last_batch = true;
+  batch.flatten_bytes = absl::MakeConstSpan(encodings);
+  yacl::Buffer buf = batch.Serialize();
+
+  // item_num, batch_index, encoding bytes and the last batch flag, four
+  // bytes each, followed by the encodings
+  ASSERT_EQ(PsiDataBatch::kHeaderSize, 16);
+  ASSERT_EQ(buf.size(), 19);
+  const uint8_t* data = buf.data<uint8_t>();
+  uint32_t item_num;
+  int32_t batch_index;
+  uint32_t flatten_bytes_size;
+  uint32_t is_last_batch;
+  std::memcpy(&item_num, data, 4);
+  std::memcpy(&batch_index, data + 4, 4);
+  std::memcpy(&flatten_bytes_size, data + 8, 4);
+  std::memcpy(&is_last_batch, data + 12, 4);
+  EXPECT_EQ(item_num, 0x01020304U);
+  EXPECT_EQ(batch_index, -2);
+  EXPECT_EQ(flatten_bytes_size, 3U);
+  EXPECT_EQ(is_last_batch, 1U);
+  EXPECT_EQ(std::memcmp(data + 16, encodings.data(), 3), 0);
+}
+
+TEST(PsiDataBatchTest, RoundTripParsesInPlace) {
+  std::vector<uint8_t> encodings(1024 * 3 * 10);
+  for (size_t i = 0; i < encodings.size(); ++i) {
+    encodings[i] = static_cast<uint8_t>(i * 31);
+  }
+  for (bool last : {false, true}) {
+    PsiDataBatch batch;
+    batch.item_num = 1024;
+    batch.batch_index = 5;
+    batch.is_last_batch = last;
+    batch.flatten_bytes = absl::MakeConstSpan(encodings);
+    yacl::Buffer buf = batch.Serialize();
+
+    PsiDataBatch parsed = PsiDataBatch::Deserialize(buf);
+    EXPECT_EQ(parsed.item_num, 1024U);
+    EXPECT_EQ(parsed.batch_index, 5);
+    EXPECT_EQ(parsed.is_last_batch, last);
+    EXPECT_EQ(parsed.flatten_bytes.data(),
+              buf.data<uint8_t>() + PsiDataBatch::kHeaderSize);
+    EXPECT_EQ(std::vector<uint8_t>(parsed.flatten_bytes.begin(),
+                                   parsed.flatten_bytes.end()),
+              encodings);
+  }
+}
+
+TEST(PsiDataBatchTest, EmptyLastBatch) {
+  PsiDataBatch batch;
+  batch.batch_index = 7;
+  batch.is_last_batch = true;
+  yacl::Buffer buf = batch.Serialize();
+  EXPECT_EQ(buf.size(), static_cast<int64_t>(PsiDataBatch::kHeaderSize));
+
+  PsiDataBatch parsed = PsiDataBatch::Deserialize(buf);
+  EXPECT_EQ(parsed.item_num, 0U);
+  EXPECT_EQ(parsed.batch_index, 7);
+  EXPECT_TRUE(parsed.is_last_batch);
+  EXPECT_TRUE(parsed.flatten_bytes.empty());
+}
+
+TEST(PsiDataBatchTest, RejectsMalformedBuffers) {
+  std::vector<uint8_t> encodings(8, 1);
+  PsiDataBatch batch;
+  batch.item_num = 1;
+  batch.flatten_bytes = absl::MakeConstSpan(encodings);
+  yacl::Buffer buf = batch.Serialize();
+
+  yacl::Buffer short_header(PsiDataBatch::kHeaderSize - 1);
+  EXPECT_ANY_THROW(PsiDataBatch::Deserialize(short_header));
+
+  yacl::Buffer truncated(buf.data<uint8_t>(), buf.size() - 1);
+  EXPECT_ANY_THROW(PsiDataBatch::Deserialize(truncated));
+
+  yacl::Buffer trailing(buf.size() + 1);
+  std::memcpy(trailing.data<uint8_t>(), buf.data<uint8_t>(), buf.size());
+  EXPECT_ANY_THROW(PsiDataBatch::Deserialize(trailing));
+}
@@ -648,6 +648,7 @@ void Baxos::ImplParDecode(absl::Span<const uint128_t> inputs, PxVector& values,
   if (num_bins_ == 1) {
     Paxos<IdxType> paxos;
     paxos.Init(1, paxos_param_, seed_);
+    paxos.add_to_decode_ = add_to_decode_;
 
     paxos.Decode(inputs, values, pp, h);
     return;
@@ -136,6 +136,10 @@ class Paxos : public PaxosParam {
   // the method for generating the row data based on the input value.
   PaxosHash<IdxType> hasher_;
 
+  // when decoding, add the decoded value to the
+  // output, as opposed to overwriting.
+  bool add_to_decode_ = false;
+
  private:
   // helper function that generates the column data given that
   // the row data has been populated (via setInput(...)).
@@ -217,10 +221,6 @@ class Paxos : public PaxosParam {
 
   // A data structure used to track the current weight of the rows.s
   WeightData<IdxType> weight_sets_;
-
-  // when decoding, add the decoded value to the
-  // output, as opposed to overwriting.
-  bool add_to_decode_ = false;
 };
 
 }  // namespace okvs
@@ -0,0 +1,74 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/okvsdhpsi/fixed_base.h"
+
+#include <utility>
+
+#include "yacl/base/exception.h"
+#include "yacl/utils/parallel.h"
+
+namespace okvsdhpsi {
+
+FixedBaseTable::FixedBaseTable(std::shared_ptr<yc::EcGroup> ec,
+                               const yc::EcPoint& base, size_t window)
+    : ec_(std::move(ec)), window_(window) {
+  YACL_ENFORCE(window_ >= 1 && window_ <= 16 && 128 % window_ == 0,
+               "unsupported window {}", window_);
+  rows_ = 128 / window_;
+  size_t digits = (size_t{1} << window_) - 1;
+  table_.resize(rows_ * digits);
+  infinity_ = ec_->Mul(base, yacl::math::MPInt(0));
+
+  // the first entry of each row is 2^(window * j) * base
+  std::vector<yc::EcPoint> row_base(rows_);
+  row_base[0] = base;
+  for (size_t j = 1; j < rows_; ++j) {
+    row_base[j] = row_base[j - 1];
+    for (size_t k = 0; k < window_; ++k) {
+      row_base[j] = ec_->Double(row_base[j]);
+    }
+  }
+  yacl::parallel_for(0, rows_, [&](int64_t begin, int64_t end) {
+    for (int64_t j = begin; j < end; ++j) {
+      yc::EcPoint* row = table_.data() + j * digits;
+      row[0] = row_base[j];
+      for (size_t d = 1; d < digits; ++d) {
+        row[d] = ec_->Add(row[d - 1], row_base[j]);
+      }
+    }
+  });
+}
+
+yc::EcPoint FixedBaseTable::Mul(uint128_t scalar) const {
+  const uint128_t digit_mask = (uint128_t(1) << window_) - 1;
+  yc::EcPoint ret;
+  bool empty = true;
+  for (size_t j = 0; j < rows_ && scalar != 0; ++j) {
+    size_t digit = static_cast<size_t>(scalar & digit_mask);
+    scalar >>= window_;
+    if (digit == 0) {
+      continue;
+    }
+    if (empty) {
+      ret = Entry(j, digit);
+      empty = false;
+    } else {
+      ec_->AddInplace(&ret, Entry(j, digit));
+    }
+  }
+  return empty ? infinity_ : ret;
+}
+
+}  // namespace okvsdhpsi
@@ -0,0 +1,52 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "yacl/base/int128.h"
+#include "yacl/crypto/ecc/ec_point.h"
+#include "yacl/crypto/ecc/ecc_spi.h"
+
+namespace okvsdhpsi {
+namespace yc = yacl::crypto;
+
+// Precomputed multiples of one point for 128-bit scalars.
+//
+// The scalar is cut into 128 / window digits; row j of the table holds
+// d * 2^(window * j) * base for every nonzero digit d, so a multiplication
+// is one table lookup and at most 128 / window point additions, with no
+// doublings. window = 8 stores 16 * 255 points.
+class FixedBaseTable {
+ public:
+  FixedBaseTable(std::shared_ptr<yc::EcGroup> ec, const yc::EcPoint& base,
+                 size_t window = 8);
+
+  yc::EcPoint Mul(uint128_t scalar) const;
+
+ private:
+  const yc::EcPoint& Entry(size_t row, size_t digit) const {
+    return table_[row * ((size_t{1} << window_) - 1) + digit - 1];
+  }
+
+  std::shared_ptr<yc::EcGroup> ec_;
+  size_t window_;
+  size_t rows_;
+  std::vector<yc::EcPoint> table_;
+  yc::EcPoint infinity_;
+};
+
+}  // namespace okvsdhpsi
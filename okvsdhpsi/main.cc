@@ -3,14 +3,18 @@
 
 #include <cstddef>
 #include <cstdlib>
+#include <cstring>
 #include <ctime>
 #include <iostream>
 #include <memory>
+#include <set>
 #include <vector>
 
+#include "examples/okvsdhpsi/fixed_base.h"
 #include "examples/okvsdhpsi/malicious/okvsdhpsi.h"
 #include "examples/okvsdhpsi/okvs/baxos.h"
 #include "examples/okvsdhpsi/semihonest/okvsdhpsi.h"
+#include "examples/psi/mask_intersection.h"
 
 #include "yacl/base/int128.h"
 #include "yacl/crypto/hash/hash_utils.h"
@@ -26,8 +30,7 @@ std::vector<uint128_t> CreateRangeItems(size_t begin, size_t size) {
   return ret;
 }
 
-void TestSemiHonest() {
-  const uint64_t level = 10;
+void TestSemiHonest(uint64_t level = 10) {
   const uint64_t num = 1 << level;
   size_t bin_size = num;
   size_t weight = 3;
@@ -158,7 +161,112 @@ void TestMalicious() {
             << " MB" << std::endl;
 }
 
+// Per-item cost of the point multiplications in OkvsDHPsi: the receiver's
+// basepoint * r_i, the sender's MulBase(r_i * sk mod order) with MPInt
+// scalars, and both through a FixedBaseTable.
+void RunFixedBaseBench() {
+  const size_t n = 1 << 16;
+  std::shared_ptr<yacl::crypto::EcGroup> ec =
+      yacl::crypto::EcGroupFactory::Instance().Create("FourQ");
+  yacl::math::MPInt sk;
+  yacl::math::MPInt::RandomLtN(ec->GetOrder(), &sk);
+  auto basepoint = ec->MulBase(sk);
+  std::vector<uint128_t> ri = yacl::crypto::RandVec<uint128_t>(n);
+  std::vector<yacl::crypto::EcPoint> mul(n);
+  std::vector<yacl::crypto::EcPoint> mulbase(n);
+  std::vector<yacl::crypto::EcPoint> fixed(n);
+
+  auto t0 = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    mul[i] = ec->Mul(basepoint, yacl::math::MPInt(ri[i]));
+  }
+  auto t1 = std::chrono::high_resolution_clock::now();
+  auto order = ec->GetOrder();
+  for (size_t i = 0; i < n; ++i) {
+    yacl::math::MPInt c;
+    yacl::math::MPInt::Mul(yacl::math::MPInt(ri[i]), sk, &c);
+    mulbase[i] = ec->MulBase(c.Mod(order));
+  }
+  auto t2 = std::chrono::high_resolution_clock::now();
+  okvsdhpsi::FixedBaseTable table(ec, basepoint);
+  auto t3 = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < n; ++i) {
+    fixed[i] = table.Mul(ri[i]);
+  }
+  auto t4 = std::chrono::high_resolution_clock::now();
+
+  for (size_t i = 0; i < n; ++i) {
+    YACL_ENFORCE(ec->PointEqual(mul[i], fixed[i]) &&
+                 ec->PointEqual(mulbase[i], fixed[i]));
+  }
+  auto per_item = [n](std::chrono::duration<double> d) {
+    return d.count() * 1e6 / n;
+  };
+  std::cout << "Mul(basepoint, r_i): " << per_item(t1 - t0) << " us/item"
+            << std::endl;
+  std::cout << "MulBase(r_i * sk mod order): " << per_item(t2 - t1)
+            << " us/item" << std::endl;
+  std::cout << "FixedBaseTable build: "
+            << std::chrono::duration<double>(t3 - t2).count() << " seconds"
+            << std::endl;
+  std::cout << "FixedBaseTable::Mul(r_i): " << per_item(t4 - t3)
+            << " us/item" << std::endl;
+}
+
+// The receiver's digest join: one heap-allocated vector per digest and a
+// std::set, against a flat buffer of mask_length-byte digests joined with
+// IntersectMasks. Then the whole semi-honest protocol at the same sizes.
+void RunDigestJoinBench() {
+  std::cout << "log2(n), vector+set join (s), flat join (s)" << std::endl;
+  for (uint64_t level = 16; level <= 20; level += 2) {
+    size_t n = size_t{1} << level;
+    size_t mask_length = ((40 + 2 * level) + 7) / 8;
+    std::vector<uint8_t> x_flat(n * mask_length);
+    std::vector<uint8_t> y_flat(n * mask_length);
+    yacl::crypto::Prg<uint8_t> prng(yacl::crypto::FastRandU128());
+    prng.Fill(absl::MakeSpan(x_flat));
+    prng.Fill(absl::MakeSpan(y_flat));
+    std::copy(x_flat.begin(), x_flat.begin() + n / 2 * mask_length,
+              y_flat.begin() + n / 4 * mask_length);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::vector<std::vector<uint8_t>> x_vec(n);
+    std::vector<std::vector<uint8_t>> y_vec(n);
+    for (size_t i = 0; i < n; ++i) {
+      x_vec[i].assign(x_flat.begin() + i * mask_length,
+                      x_flat.begin() + (i + 1) * mask_length);
+      y_vec[i].assign(y_flat.begin() + i * mask_length,
+                      y_flat.begin() + (i + 1) * mask_length);
+    }
+    std::set<std::vector<uint8_t>> set(x_vec.begin(), x_vec.end());
+    size_t z_set = 0;
+    for (const auto& y : y_vec) {
+      z_set += set.count(y);
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<uint128_t> x(n, 0);
+    std::vector<uint128_t> y(n, 0);
+    for (size_t i = 0; i < n; ++i) {
+      std::memcpy(&x[i], x_flat.data() + i * mask_length, mask_length);
+      std::memcpy(&y[i], y_flat.data() + i * mask_length, mask_length);
+    }
+    auto z = examples::psi::IntersectMasks(x, y);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    YACL_ENFORCE(z.size() == z_set);
+    std::chrono::duration<double> set_duration = t1 - t0;
+    std::chrono::duration<double> flat_duration = t2 - t1;
+    std::cout << level << ", " << set_duration.count() << ", "
+              << flat_duration.count() << std::endl;
+  }
+  for (uint64_t level = 16; level <= 20; level += 2) {
+    TestSemiHonest(level);
+  }
+}
+
 int main() {
   TestSemiHonest();
+  RunFixedBaseBench();
+  RunDigestJoinBench();
   // TestMalicious();
 }
\ No newline at end of file
@@ -20,6 +20,7 @@
 #include <string>
 #include <vector>
 
+#include "examples/okvsdhpsi/fixed_base.h"
 #include "examples/okvsdhpsi/okvs/baxos.h"
 
 #include "yacl/base/int128.h"
@@ -67,9 +68,10 @@ void OkvsDHPsi::PointstoBuffer(absl::Span<yc::EcPoint> in,
 void OkvsDHPsi::MaskEcPointsD(yc::EcPoint in, absl::Span<std::string> out,
                               absl::Span<uint128_t> sks) {
   YACL_ENFORCE(sks.size() == out.size());
+  okvsdhpsi::FixedBaseTable table(ec_, in);
   yacl::parallel_for(0, sks.size(), [&](size_t begin, size_t end) {
     for (size_t idx = begin; idx < end; ++idx) {
-      out[idx] = ec_->SerializePoint(ec_->Mul(in, yacl::math::MPInt(sks[idx])));
+      out[idx] = ec_->SerializePoint(table.Mul(sks[idx]));
     }
   });
 }
@@ -134,16 +136,15 @@ void OkvsDHPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
   std::memcpy(p.data(), buf.data(), buf.size());
   std::vector<uint128_t> ri(x.size());
   baxos.Decode(absl::MakeSpan(x), absl::MakeSpan(ri), absl::MakeSpan(p), 8);
-  std::vector<yacl::math::MPInt> cs(n);
-  auto order = send.ec_->GetOrder();
+  // g^(r_i * sk mod order) = basepoint^r_i, so the 128-bit r_i is used as
+  // the scalar directly and no mod-order product is needed
+  okvsdhpsi::FixedBaseTable table(send.ec_, basepoint);
   std::vector<yc::EcPoint> x_points(n);
   std::vector<uint128_t> x_str(n);  // 存储每个点的哈希值
 
   yacl::parallel_for(0, n, [&](int64_t beg, int64_t end) {
     for (int64_t i = beg; i < end; ++i) {
-      yacl::math::MPInt::Mul(yacl::math::MPInt(ri[i]), send.sk_, &cs[i]);
-      cs[i] = cs[i].Mod(order);
-      x_points[i] = send.ec_->MulBase(cs[i]);
+      x_points[i] = table.Mul(ri[i]);
       std::vector<uint8_t> serialized_point(max_point_length);
       send.ec_->SerializePoint(x_points[i], serialized_point.data(),
                                max_point_length);
@@ -14,14 +14,18 @@
 
 #include "examples/okvsdhpsi/semihonest/okvsdhpsi.h"
 
+#include <array>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <vector>
 
 #include "c/blake3.h"
+#include "examples/okvsdhpsi/fixed_base.h"
 #include "examples/okvsdhpsi/okvs/baxos.h"
+#include "examples/psi/mask_intersection.h"
 
 #include "yacl/base/int128.h"
 #include "yacl/crypto/ecc/ec_point.h"
@@ -31,41 +35,13 @@
 
 namespace semihonest {
 
-inline std::vector<uint8_t> HashToFixedSize(size_t bytesize,
-                                            const std::vector<uint8_t>& input) {
-  std::vector<uint8_t> hashResult(bytesize);
-
-  // Create a new blake3 hasher
+// Writes the first bytesize bytes of Blake3(point) to out.
+inline void HashToFixedSize(const uint8_t* point, size_t point_size,
+                            uint8_t* out, size_t bytesize) {
   blake3_hasher hasher;
   blake3_hasher_init(&hasher);
-
-  // Write the input bytes to the hash
-  blake3_hasher_update(&hasher, input.data(), input.size());
-
-  // Generate the hash with the desired size
-  blake3_hasher_finalize(&hasher, hashResult.data(), bytesize);
-
-  return hashResult;
-}
-
-inline std::vector<int32_t> GetIntersectionIdx(
-    const std::vector<std::vector<uint8_t>>& x,
-    const std::vector<std::vector<uint8_t>>& y) {
-  // 使用 std::set<std::vector<uint8_t>> 来存储集合
-  std::set<std::vector<uint8_t>> set;
-  for (const auto& item : x) {
-    set.insert(item);
-  }
-  std::vector<int32_t> ret(y.size(), -1);  // 初始化为 -1
-  yacl::parallel_for(0, y.size(), [&](size_t start, size_t end) {
-    for (size_t i = start; i < end; ++i) {
-      if (set.count(y[i]) != 0) {
-        ret[i] = i;
-      }
-    }
-  });
-  ret.erase(std::remove(ret.begin(), ret.end(), -1), ret.end());
-  return ret;
+  blake3_hasher_update(&hasher, point, point_size);
+  blake3_hasher_finalize(&hasher, out, bytesize);
 }
 
 yacl::crypto::EcPoint OkvsDHPsi::GetBasePoint() {
@@ -83,16 +59,18 @@ void OkvsDHPsi::PointstoBuffer(absl::Span<yc::EcPoint> in,
   });
 }
 
-void OkvsDHPsi::MaskEcPointsD(yc::EcPoint in,
-                              absl::Span<std::vector<uint8_t>> out,
-                              absl::Span<uint128_t> sks) {
+void OkvsDHPsi::MaskEcPointsD(yc::EcPoint in, absl::Span<uint128_t> out,
+                              absl::Span<uint128_t> sks, size_t mask_length) {
   YACL_ENFORCE(sks.size() == out.size());
+  YACL_ENFORCE(mask_length <= sizeof(uint128_t));
+  okvsdhpsi::FixedBaseTable table(ec_, in);
   yacl::parallel_for(0, sks.size(), [&](size_t begin, size_t end) {
+    std::array<uint8_t, 32> serialized_point;
     for (size_t idx = begin; idx < end; ++idx) {
-      std::vector<uint8_t> serialized_point(32);
-      ec_->SerializePoint(ec_->Mul(in, yacl::math::MPInt(sks[idx])),
-                          serialized_point.data(), 32);
-      out[idx] = serialized_point;
+      ec_->SerializePoint(table.Mul(sks[idx]), serialized_point.data(), 32);
+      out[idx] = 0;
+      HashToFixedSize(serialized_point.data(), serialized_point.size(),
+                      reinterpret_cast<uint8_t*>(&out[idx]), mask_length);
     }
   });
 }
@@ -120,28 +98,22 @@ std::vector<int32_t> OkvsDHPsiRecv(
       ctx->NextRank(),
       yacl::ByteContainerView(p.data(), okvssize * sizeof(uint128_t)),
       "Send P");
-  std::vector<std::vector<uint8_t>> y_mask(n);
-  std::vector<std::vector<uint8_t>> y_str(n);
-  recv.MaskEcPointsD(basepoint, absl::MakeSpan(y_mask), absl::MakeSpan(ri));
-  yacl::parallel_for(0, n, [&](int64_t beg, int64_t end) {
-    for (int64_t i = beg; i < end; ++i) {
-      y_str[i] = HashToFixedSize(mask_length, y_mask[i]);
-    }
-  });
+  std::vector<uint128_t> y_str(n);
+  recv.MaskEcPointsD(basepoint, absl::MakeSpan(y_str), absl::MakeSpan(ri),
+                     mask_length);
 
-  std::vector<std::vector<uint8_t>> x_str(n, std::vector<uint8_t>(mask_length));
+  // x_str arrives as n digests of mask_length bytes each
+  std::vector<uint128_t> x_str(n, 0);
   auto buf = ctx->Recv(ctx->PrevRank(), "Receive x_str");
   YACL_ENFORCE(buf.size() == int64_t(n * mask_length));
-
-  // 使用 yacl::parallel_for 并发复制数据
   yacl::parallel_for(0, n, [&](size_t begin, size_t end) {
-    const uint8_t* buf_ptr =
-        static_cast<const uint8_t*>(buf.data());  // 转换为 uint8_t* 或 char*
+    const auto* buf_ptr = static_cast<const uint8_t*>(buf.data());
     for (size_t i = begin; i < end; ++i) {
-      std::memcpy(x_str[i].data(), buf_ptr + (i * mask_length), mask_length);
+      std::memcpy(&x_str[i], buf_ptr + i * mask_length, mask_length);
     }
   });
-  auto z = GetIntersectionIdx(x_str, y_str);
+  auto idx = examples::psi::IntersectMasks(x_str, y_str);
+  std::vector<int32_t> z(idx.begin(), idx.end());
   return z;
 }
 
@@ -165,26 +137,19 @@ void OkvsDHPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
   std::memcpy(p.data(), buf.data(), buf.size());
   std::vector<uint128_t> ri(x.size());
   baxos.Decode(absl::MakeSpan(x), absl::MakeSpan(ri), absl::MakeSpan(p), 8);
-  std::vector<yacl::math::MPInt> cs(n);
-  auto order = send.ec_->GetOrder();
-  std::vector<yc::EcPoint> x_points(n);
+  // g^(r_i * sk mod order) = basepoint^r_i, so the 128-bit r_i is used as
+  // the scalar directly and no mod-order product is needed
+  okvsdhpsi::FixedBaseTable table(send.ec_, basepoint);
+  YACL_ENFORCE(mask_length <= sizeof(uint128_t));
   std::vector<uint8_t> flat_x_str(n * mask_length);
 
   yacl::parallel_for(0, n, [&](int64_t beg, int64_t end) {
+    std::vector<uint8_t> serialized_point(max_point_length);
     for (int64_t i = beg; i < end; ++i) {
-      yacl::math::MPInt::Mul(yacl::math::MPInt(ri[i]), send.sk_, &cs[i]);
-      cs[i] = cs[i].Mod(order);
-      x_points[i] = send.ec_->MulBase(cs[i]);
-
-      std::vector<uint8_t> serialized_point(max_point_length);
-      send.ec_->SerializePoint(x_points[i], serialized_point.data(),
+      send.ec_->SerializePoint(table.Mul(ri[i]), serialized_point.data(),
                                max_point_length);
-
-      std::vector<uint8_t> hashed_point =
-          HashToFixedSize(mask_length, serialized_point);
-
-      std::memcpy(flat_x_str.data() + i * mask_length, hashed_point.data(),
-                  mask_length);
+      HashToFixedSize(serialized_point.data(), max_point_length,
+                      flat_x_str.data() + i * mask_length, mask_length);
     }
   });
 
@@ -38,8 +38,10 @@ class OkvsDHPsi {
     yc::MPInt::RandomLtN(ec_->GetOrder(), &sk_);
   }
   yacl::crypto::EcPoint GetBasePoint();
-  void MaskEcPointsD(yc::EcPoint in, absl::Span<std::vector<uint8_t>> out,
-                     absl::Span<uint128_t> sks);
+  // out[i] = the first mask_length bytes of Blake3(in * sks[i]), zero
+  // extended; mask_length is at most 16.
+  void MaskEcPointsD(yc::EcPoint in, absl::Span<uint128_t> out,
+                     absl::Span<uint128_t> sks, size_t mask_length);
   void PointstoBuffer(absl::Span<yc::EcPoint> in,
                       absl::Span<std::uint8_t> buffer);
 
@@ -14,31 +14,93 @@
 
 #include "examples/psi/ecdh_psi.h"
 
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <string_view>
 #include <vector>
 
+#include "examples/psi/point_batch.h"
+
 #include "yacl/crypto/ecc/ec_point.h"
 #include "yacl/crypto/ecc/ecc_spi.h"
 #include "yacl/link/link.h"
 #include "yacl/secparam.h"
+#include "yacl/utils/parallel.h"
 
 namespace examples::psi {
 
+namespace {
+
+// Runs fn over [begin, end) on at most num_threads tasks of the yacl pool,
+// or on the whole pool if num_threads is 0.
+void ParallelFor(int64_t begin, int64_t end, size_t num_threads,
+                 const std::function<void(int64_t, int64_t)>& fn) {
+  if (num_threads == 0) {
+    yacl::parallel_for(begin, end, fn);
+    return;
+  }
+  int64_t grain = (end - begin + num_threads - 1) / num_threads;
+  yacl::parallel_for(begin, end, std::max<int64_t>(grain, 1), fn);
+}
+
+}  // namespace
+
 void EcdhPsi::MaskStrings(absl::Span<std::string> in,
                           absl::Span<yc::EcPoint> out) {
   YACL_ENFORCE(in.size() == out.size());
-  for (size_t i = 0; i < in.size(); ++i) {
-    out[i] = ec_->HashToCurve(yc::HashToCurveStrategy::Autonomous, in[i]);
-    ec_->MulInplace(&out[i], sk_);
-  }
+  ParallelFor(0, in.size(), num_threads_, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      out[i] = ec_->HashToCurve(yc::HashToCurveStrategy::Autonomous, in[i]);
+      ec_->MulInplace(&out[i], sk_);
+    }
+  });
 }
 
 void EcdhPsi::MaskEcPoints(absl::Span<yc::EcPoint> in,
                            absl::Span<std::string> out) {
   YACL_ENFORCE(in.size() == out.size());
-  for (size_t i = 0; i < in.size(); ++i) {
-    out[i] = ec_->SerializePoint(ec_->Mul(in[i], sk_));
-  }
+  ParallelFor(0, in.size(), num_threads_, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      out[i] = ec_->SerializePoint(ec_->Mul(in[i], sk_));
+    }
+  });
+}
+
+void EcdhPsi::MaskItems(absl::Span<const uint128_t> in,
+                        absl::Span<yc::EcPoint> out) {
+  YACL_ENFORCE(in.size() == out.size());
+  ParallelFor(0, in.size(), num_threads_, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      std::string_view item(reinterpret_cast<const char*>(&in[i]),
+                            sizeof(uint128_t));
+      out[i] = ec_->HashToCurve(yc::HashToCurveStrategy::Autonomous, item);
+      ec_->MulInplace(&out[i], sk_);
+    }
+  });
+}
+
+void EcdhPsi::MaskEcPoints(absl::Span<const yc::EcPoint> in,
+                           absl::Span<uint8_t> out) {
+  size_t point_size = PointSize();
+  YACL_ENFORCE(out.size() == in.size() * point_size);
+  ParallelFor(0, in.size(), num_threads_, [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      ec_->SerializePoint(ec_->Mul(in[i], sk_), out.data() + i * point_size,
+                          point_size);
+    }
+  });
+}
+
+void EcdhPsi::SerializePoints(absl::Span<const yc::EcPoint> in,
+                              absl::Span<uint8_t> out) const {
+  examples::psi::SerializePoints(*ec_, in, PointSize(), out);
+}
+
+void EcdhPsi::DeserializePoints(absl::Span<const uint8_t> in,
+                                absl::Span<yc::EcPoint> out) const {
+  examples::psi::DeserializePoints(*ec_, in, PointSize(), out);
+  examples::psi::CheckPointsInGroup(*ec_, out);
 }
 
 }  // namespace examples::psi
@@ -17,6 +17,9 @@
 #include <memory>
 #include <vector>
 
+#include "absl/types/span.h"
+
+#include "yacl/base/int128.h"
 #include "yacl/crypto/ecc/ec_point.h"
 #include "yacl/crypto/ecc/ecc_spi.h"
 #include "yacl/link/link.h"
@@ -35,7 +38,9 @@ namespace yc = yacl::crypto;
 //
 class EcdhPsi {
  public:
-  EcdhPsi() {
+  // The masking calls run on at most num_threads tasks of the yacl pool, or
+  // on the whole pool if num_threads is 0.
+  explicit EcdhPsi(size_t num_threads = 0) : num_threads_(num_threads) {
     // Use FourQ curve
     ec_ = yc::EcGroupFactory::Instance().Create(/* curve name */ "FourQ");
 
@@ -50,9 +55,34 @@ class EcdhPsi {
   // EcPoint strings
   void MaskEcPoints(absl::Span<yc::EcPoint> in, absl::Span<std::string> out);
 
+  // ---------------------------------------------------------------------
+  // Batch interface for fixed-width items. Points are serialized back to
+  // back, PointSize() bytes each, into caller-owned buffers that can be
+  // reused from one batch to the next.
+  // ---------------------------------------------------------------------
+
+  // Serialized length of one point
+  size_t PointSize() const { return ec_->GetSerializeLength(); }
+
+  // Mask input items (hashed to curve from their 16 little-endian bytes)
+  // with secret key, and outputs the EcPoint results
+  void MaskItems(absl::Span<const uint128_t> in, absl::Span<yc::EcPoint> out);
+
+  // Mask input EcPoints with secret key, and writes the serialized results
+  // to out, which must hold in.size() * PointSize() bytes
+  void MaskEcPoints(absl::Span<const yc::EcPoint> in, absl::Span<uint8_t> out);
+
+  void SerializePoints(absl::Span<const yc::EcPoint> in,
+                       absl::Span<uint8_t> out) const;
+
+  // Throws if any point is not in the group
+  void DeserializePoints(absl::Span<const uint8_t> in,
+                         absl::Span<yc::EcPoint> out) const;
+
  private:
   yc::MPInt sk_;                     // secret key
   std::shared_ptr<yc::EcGroup> ec_;  // ec group
+  size_t num_threads_;
 };
 
 }  // namespace examples::psi
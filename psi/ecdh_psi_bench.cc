@@ -0,0 +1,64 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+#include "examples/psi/ecdh_psi.h"
+
+#include "yacl/crypto/rand/rand.h"
+#include "yacl/crypto/tools/prg.h"
+#include "yacl/utils/parallel.h"
+
+// Masking throughput of the batch interface (hash-to-curve and first
+// exponentiation, then second exponentiation and serialization) for an
+// increasing number of threads. The yacl pool is sized once per process, so
+// each row caps the number of tasks instead; rows beyond the pool size
+// cannot scale further.
+int main() {
+  size_t n = size_t{1} << 18;
+  size_t batch = size_t{1} << 14;
+  std::vector<uint128_t> items(n);
+  yacl::crypto::Prg<uint128_t> prng(yacl::crypto::FastRandU128());
+  prng.Fill(absl::MakeSpan(items));
+
+  std::vector<yacl::crypto::EcPoint> points(batch);
+
+  std::cout << "pool threads: " << yacl::get_num_threads() << std::endl;
+  std::cout << "threads, MaskItems (s), MaskEcPoints (s), items/s"
+            << std::endl;
+  for (size_t threads : {1, 2, 4, 8, 16, 32}) {
+    examples::psi::EcdhPsi alice(threads);
+    examples::psi::EcdhPsi bob(threads);
+    std::vector<uint8_t> buffer(batch * alice.PointSize());
+    std::chrono::duration<double> first{0};
+    std::chrono::duration<double> second{0};
+    for (size_t begin = 0; begin < n; begin += batch) {
+      size_t len = std::min(batch, n - begin);
+      auto pts = absl::MakeSpan(points).subspan(0, len);
+      auto start_time = std::chrono::high_resolution_clock::now();
+      alice.MaskItems(absl::MakeSpan(items).subspan(begin, len), pts);
+      auto mid_time = std::chrono::high_resolution_clock::now();
+      bob.MaskEcPoints(pts, absl::MakeSpan(buffer).subspan(
+                                0, len * alice.PointSize()));
+      auto end_time = std::chrono::high_resolution_clock::now();
+      first += mid_time - start_time;
+      second += end_time - mid_time;
+    }
+    std::cout << threads << ", " << first.count() << ", " << second.count()
+              << ", " << n / (first.count() + second.count()) << std::endl;
+  }
+}
@@ -41,6 +41,24 @@ inline std::vector<size_t> GetIntersectionIdx(
   }
   return ret;
 }
+
+std::vector<uint128_t> CreateRangeU128Items(size_t begin, size_t size) {
+  std::vector<uint128_t> ret;
+  for (size_t i = 0; i < size; i++) {
+    ret.push_back(yacl::MakeUint128((begin + i) % 7, begin + i));
+  }
+  return ret;
+}
+
+std::vector<std::string> SplitPoints(const std::vector<uint8_t> &buffer,
+                                     size_t point_size) {
+  std::vector<std::string> ret;
+  for (size_t i = 0; i < buffer.size(); i += point_size) {
+    ret.emplace_back(reinterpret_cast<const char *>(buffer.data() + i),
+                     point_size);
+  }
+  return ret;
+}
 }  // namespace
 
 TEST(PsiTest, Works) {
@@ -101,4 +119,57 @@ TEST(PsiTest, Works) {
   }
 }
 
+TEST(PsiTest, BatchWorks) {
+  size_t n = 1000;
+  size_t batch = 128;
+  auto x = CreateRangeU128Items(0, n);
+  auto y = CreateRangeU128Items(300, n);
+
+  EcdhPsi alice;
+  EcdhPsi bob;
+  size_t point_size = alice.PointSize();
+
+  // x_buffer = H(x) ^ {alice_sk}, y_buffer = H(y) ^ {bob_sk}, serialized
+  std::vector<uint8_t> x_buffer(n * point_size);
+  std::vector<uint8_t> y_buffer(n * point_size);
+  std::vector<yc::EcPoint> points(batch);
+  for (size_t begin = 0; begin < n; begin += batch) {
+    size_t len = std::min(batch, n - begin);
+    auto pts = absl::MakeSpan(points).subspan(0, len);
+    alice.MaskItems(absl::MakeSpan(x).subspan(begin, len), pts);
+    alice.SerializePoints(pts, absl::MakeSpan(x_buffer).subspan(
+                                   begin * point_size, len * point_size));
+    bob.MaskItems(absl::MakeSpan(y).subspan(begin, len), pts);
+    bob.SerializePoints(pts, absl::MakeSpan(y_buffer).subspan(
+                                 begin * point_size, len * point_size));
+  }
+
+  // x_str = x_points ^ {bob_sk}, y_str = y_points ^ {alice_sk}, reusing one
+  // point vector and one buffer per party
+  std::vector<uint8_t> x_str(n * point_size);
+  std::vector<uint8_t> y_str(n * point_size);
+  for (size_t begin = 0; begin < n; begin += batch) {
+    size_t len = std::min(batch, n - begin);
+    auto pts = absl::MakeSpan(points).subspan(0, len);
+    bob.DeserializePoints(absl::MakeSpan(x_buffer).subspan(begin * point_size,
+                                                           len * point_size),
+                          pts);
+    bob.MaskEcPoints(pts, absl::MakeSpan(x_str).subspan(begin * point_size,
+                                                        len * point_size));
+    alice.DeserializePoints(absl::MakeSpan(y_buffer).subspan(
+                                begin * point_size, len * point_size),
+                            pts);
+    alice.MaskEcPoints(pts, absl::MakeSpan(y_str).subspan(begin * point_size,
+                                                          len * point_size));
+  }
+
+  std::vector<size_t> expected;
+  for (size_t i = 0; i + 300 < n; ++i) {
+    expected.push_back(i);
+  }
+  EXPECT_EQ(GetIntersectionIdx(SplitPoints(x_str, point_size),
+                               SplitPoints(y_str, point_size)),
+            expected);
+}
+
 }  // namespace examples::psi
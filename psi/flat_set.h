@@ -0,0 +1,173 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "absl/types/span.h"
+
+#include "yacl/base/exception.h"
+
+namespace examples::psi {
+
+// Finalizer for FlatSet hashes: spreads a 64-bit value so that both its low
+// bits, which pick the home slot, and its top bits, which make the
+// fingerprint, depend on all of its input.
+inline uint64_t MixHash(uint64_t h) {
+  h ^= h >> 32;
+  h *= 0xD6E8FEB86659FD93ULL;
+  h ^= h >> 32;
+  return h;
+}
+
+// Open-addressing set of fixed-width keys.
+//
+// Keys live inline in one flat array and are found by linear probing from
+// Hash()(key) & (capacity - 1); a parallel array of control bytes holds the
+// top 7 hash bits of every occupied slot, so most mismatches never touch
+// the key. Erase uses backward-shift deletion, so there are no tombstones
+// and the table never degrades under long update sequences. The load factor
+// is kept at or below 1/2.
+//
+// Hash is a default-constructible functor returning a well-mixed uint64_t,
+// typically MixHash of some bits of the key.
+template <typename Key, typename Hash>
+class FlatSet {
+ public:
+  FlatSet() = default;
+
+  // Makes room for n keys without rehashing.
+  void Reserve(size_t n) {
+    size_t capacity = 16;
+    while (capacity < 2 * n) {
+      capacity <<= 1;
+    }
+    if (capacity > ctrl_.size()) {
+      Rehash(capacity);
+    }
+  }
+
+  void Insert(absl::Span<const Key> keys) {
+    Reserve(size_ + keys.size());
+    for (const auto& key : keys) {
+      uint64_t h = Hash()(key);
+      size_t slot = Find(key, h);
+      if (ctrl_[slot] == 0) {
+        ctrl_[slot] = Control(h);
+        keys_[slot] = key;
+        ++size_;
+      }
+    }
+  }
+
+  void Erase(absl::Span<const Key> keys) {
+    if (size_ == 0) {
+      return;
+    }
+    for (const auto& key : keys) {
+      size_t hole = Find(key, Hash()(key));
+      if (ctrl_[hole] == 0) {
+        continue;
+      }
+      // Shift later members of the probe run back into the hole unless they
+      // would move before their home slot.
+      for (size_t next = (hole + 1) & mask_; ctrl_[next] != 0;
+           next = (next + 1) & mask_) {
+        size_t home = Hash()(keys_[next]) & mask_;
+        bool stays = (next > hole) ? (home > hole && home <= next)
+                                   : (home > hole || home <= next);
+        if (!stays) {
+          ctrl_[hole] = ctrl_[next];
+          keys_[hole] = keys_[next];
+          hole = next;
+        }
+      }
+      ctrl_[hole] = 0;
+      --size_;
+    }
+  }
+
+  bool Contains(const Key& key) const {
+    if (size_ == 0) {
+      return false;
+    }
+    return ctrl_[Find(key, Hash()(key))] != 0;
+  }
+
+  size_t size() const { return size_; }
+
+  // Calls fn(const Key&) on every key, in table order.
+  template <typename F>
+  void ForEach(F&& fn) const {
+    for (size_t i = 0; i < ctrl_.size(); ++i) {
+      if (ctrl_[i] != 0) {
+        fn(keys_[i]);
+      }
+    }
+  }
+
+  void Clear() {
+    keys_.clear();
+    ctrl_.clear();
+    mask_ = 0;
+    size_ = 0;
+  }
+
+ private:
+  // occupied slots have the top bit set
+  static uint8_t Control(uint64_t h) { return 0x80 | (h >> 57); }
+
+  // Slot holding key, or the empty slot where it would go.
+  size_t Find(const Key& key, uint64_t h) const {
+    uint8_t ctrl = Control(h);
+    size_t slot = h & mask_;
+    while (ctrl_[slot] != 0) {
+      if (ctrl_[slot] == ctrl && keys_[slot] == key) {
+        return slot;
+      }
+      slot = (slot + 1) & mask_;
+    }
+    return slot;
+  }
+
+  void Rehash(size_t capacity) {
+    YACL_ENFORCE((capacity & (capacity - 1)) == 0);
+    std::vector<Key> keys(capacity);
+    std::vector<uint8_t> ctrl(capacity, 0);
+    std::swap(keys, keys_);
+    std::swap(ctrl, ctrl_);
+    mask_ = capacity - 1;
+    for (size_t i = 0; i < ctrl.size(); ++i) {
+      if (ctrl[i] != 0) {
+        size_t slot = Hash()(keys[i]) & mask_;
+        while (ctrl_[slot] != 0) {
+          slot = (slot + 1) & mask_;
+        }
+        ctrl_[slot] = ctrl[i];
+        keys_[slot] = keys[i];
+      }
+    }
+  }
+
+  std::vector<Key> keys_;
+  std::vector<uint8_t> ctrl_;  // 0 = empty
+  size_t mask_ = 0;
+  size_t size_ = 0;
+};
+
+}  // namespace examples::psi
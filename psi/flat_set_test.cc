@@ -0,0 +1,164 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/psi/flat_set.h"
+
+#include <cstdint>
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "yacl/crypto/rand/rand.h"
+
+namespace examples::psi {
+
+namespace {
+
+// Key k has home slot k >> 8 in any table of at least 256 slots, and
+// k >> 8 modulo the capacity in smaller ones, so tests can place keys.
+struct SlotHash {
+  uint64_t operator()(uint64_t key) const { return key >> 8; }
+};
+
+struct MixedHash {
+  uint64_t operator()(uint64_t key) const { return MixHash(key); }
+};
+
+// Four home slots, the last three of a 16 or 32 slot table and slot 0, so
+// probe runs are long and cross the wrap.
+struct CollidingHash {
+  uint64_t operator()(uint64_t key) const { return (key & 3) + 29; }
+};
+
+uint64_t KeyAt(uint64_t slot, uint64_t id) { return (slot << 8) | id; }
+
+std::set<uint64_t> Members(const FlatSet<uint64_t, SlotHash>& set) {
+  std::set<uint64_t> ret;
+  set.ForEach([&](uint64_t key) { ret.insert(key); });
+  return ret;
+}
+
+}  // namespace
+
+TEST(FlatSetTest, InsertAndErase) {
+  FlatSet<uint64_t, MixedHash> set;
+  std::vector<uint64_t> keys = {1, 2, 3, 2};
+  set.Insert(absl::MakeSpan(keys));
+  EXPECT_EQ(set.size(), 3);
+  EXPECT_TRUE(set.Contains(2));
+  EXPECT_FALSE(set.Contains(4));
+
+  std::vector<uint64_t> erased = {2, 4};
+  set.Erase(absl::MakeSpan(erased));
+  EXPECT_EQ(set.size(), 2);
+  EXPECT_FALSE(set.Contains(2));
+  EXPECT_TRUE(set.Contains(1));
+  EXPECT_TRUE(set.Contains(3));
+
+  set.Clear();
+  EXPECT_EQ(set.size(), 0);
+  EXPECT_FALSE(set.Contains(1));
+}
+
+TEST(FlatSetTest, EraseShiftsRunAcrossWraparound) {
+  // 16 slots: a and b start at 14 and 15, c, homed at 15, wraps to 0, and
+  // d, homed at 14, wraps to 1.
+  FlatSet<uint64_t, SlotHash> set;
+  set.Reserve(8);
+  uint64_t a = KeyAt(14, 0);
+  uint64_t b = KeyAt(14, 1);
+  uint64_t c = KeyAt(15, 0);
+  uint64_t d = KeyAt(14, 2);
+  std::vector<uint64_t> keys = {a, b, c, d};
+  set.Insert(absl::MakeSpan(keys));
+
+  // Erasing a shifts b, c and d back by one, c and d across the wrap.
+  std::vector<uint64_t> erase_a = {a};
+  set.Erase(absl::MakeSpan(erase_a));
+  EXPECT_EQ(Members(set), std::set<uint64_t>({b, c, d}));
+  EXPECT_FALSE(set.Contains(a));
+
+  // c now sits at 15, its home: erasing the wrapped d must leave it there,
+  // and erasing c must not lose b.
+  std::vector<uint64_t> erase_d = {d};
+  set.Erase(absl::MakeSpan(erase_d));
+  EXPECT_TRUE(set.Contains(b));
+  EXPECT_TRUE(set.Contains(c));
+  std::vector<uint64_t> erase_c = {c};
+  set.Erase(absl::MakeSpan(erase_c));
+  EXPECT_EQ(Members(set), std::set<uint64_t>({b}));
+
+  // Refill the run across the wrap.
+  uint64_t e = KeyAt(0, 0);
+  EXPECT_FALSE(set.Contains(e));
+  std::vector<uint64_t> more = {e, a, d};
+  set.Insert(absl::MakeSpan(more));
+  EXPECT_EQ(Members(set), std::set<uint64_t>({a, b, d, e}));
+}
+
+TEST(FlatSetTest, EraseKeepsKeysAtOrPastTheirHome) {
+  // x, y, z and w are homed at 14, 15, 0 and 0 and fill 14, 15, 0 and 1.
+  // Erasing x must not move any of the others: each is at or after its home,
+  // and moving one into the hole would put it before its home.
+  FlatSet<uint64_t, SlotHash> set;
+  set.Reserve(8);
+  uint64_t x = KeyAt(14, 0);
+  uint64_t y = KeyAt(15, 0);
+  uint64_t z = KeyAt(0, 0);
+  uint64_t w = KeyAt(0, 1);
+  std::vector<uint64_t> keys = {x, y, z, w};
+  set.Insert(absl::MakeSpan(keys));
+  std::vector<uint64_t> erase_x = {x};
+  set.Erase(absl::MakeSpan(erase_x));
+  EXPECT_EQ(Members(set), std::set<uint64_t>({y, z, w}));
+  for (uint64_t key : {y, z, w}) {
+    EXPECT_TRUE(set.Contains(key));
+  }
+
+  // with x gone, a key homed at 14 lands there again
+  uint64_t v = KeyAt(14, 1);
+  std::vector<uint64_t> add_v = {v};
+  set.Insert(absl::MakeSpan(add_v));
+  std::vector<uint64_t> erase_yz = {y, z};
+  set.Erase(absl::MakeSpan(erase_yz));
+  EXPECT_EQ(Members(set), std::set<uint64_t>({v, w}));
+  EXPECT_TRUE(set.Contains(w));
+}
+
+TEST(FlatSetTest, MatchesStdSetUnderCollisions) {
+  FlatSet<uint64_t, CollidingHash> set;
+  std::set<uint64_t> expected;
+  for (int round = 0; round < 200; ++round) {
+    std::vector<uint64_t> batch(1 + yacl::crypto::FastRandU64() % 6);
+    for (auto& key : batch) {
+      key = yacl::crypto::FastRandU64() % 10;
+    }
+    if (yacl::crypto::FastRandU64() % 2 == 0) {
+      set.Insert(absl::MakeSpan(batch));
+      expected.insert(batch.begin(), batch.end());
+    } else {
+      set.Erase(absl::MakeSpan(batch));
+      for (auto key : batch) {
+        expected.erase(key);
+      }
+    }
+    ASSERT_EQ(set.size(), expected.size());
+    for (uint64_t key = 0; key < 10; ++key) {
+      ASSERT_EQ(set.Contains(key), expected.count(key) != 0) << key;
+    }
+  }
+}
+
+}  // namespace examples::psi
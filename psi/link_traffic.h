@@ -0,0 +1,49 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+
+#include "yacl/link/context.h"
+
+namespace examples::psi {
+
+// Messages and bytes a party sent and received. yacl counts these per
+// Context and a spawned context starts from zero, so a protocol that spawns
+// contexts adds their counters here for the caller to report.
+struct LinkTraffic {
+  size_t sent_bytes = 0;
+  size_t recv_bytes = 0;
+  size_t sent_actions = 0;
+  size_t recv_actions = 0;
+
+  // Adds the counters of ctx so far.
+  void Add(const yacl::link::Context& ctx) {
+    auto stats = ctx.GetStats();
+    sent_bytes += stats->sent_bytes.load();
+    recv_bytes += stats->recv_bytes.load();
+    sent_actions += stats->sent_actions.load();
+    recv_actions += stats->recv_actions.load();
+  }
+
+  void Add(const LinkTraffic& other) {
+    sent_bytes += other.sent_bytes;
+    recv_bytes += other.recv_bytes;
+    sent_actions += other.sent_actions;
+    recv_actions += other.recv_actions;
+  }
+};
+
+}  // namespace examples::psi
@@ -0,0 +1,200 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/psi/mask_intersection.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "yacl/base/exception.h"
+#include "yacl/utils/parallel.h"
+
+namespace examples::psi {
+
+namespace {
+
+// Partitions are sized so that the per-partition hash table (two slots per
+// entry) and its values stay within L2.
+constexpr size_t kPartitionTarget = size_t{1} << 12;
+constexpr size_t kMaxPartitionBits = 12;
+
+// Scatter and collect passes split their input into at most kMaxChunks
+// ranges of at least kMinChunk elements.
+constexpr size_t kMaxChunks = 64;
+constexpr size_t kMinChunk = size_t{1} << 14;
+
+constexpr uint32_t kEmpty = std::numeric_limits<uint32_t>::max();
+
+inline uint64_t MixMask(uint128_t v) {
+  uint64_t x = static_cast<uint64_t>(v) ^
+               (static_cast<uint64_t>(v >> 64) * 0x9E3779B97F4A7C15ULL);
+  x ^= x >> 32;
+  x *= 0xD6E8FEB86659FD93ULL;
+  x ^= x >> 32;
+  return x;
+}
+
+struct Partitioned {
+  std::vector<uint128_t> values;
+  // original position of values[k]
+  std::vector<uint32_t> index;
+  // partition p occupies [bounds[p], bounds[p + 1])
+  std::vector<size_t> bounds;
+};
+
+size_t NumChunks(size_t n) {
+  return std::max<size_t>(1, std::min(kMaxChunks, n / kMinChunk));
+}
+
+// Two-pass parallel radix scatter on the top `bits` bits of MixMask.
+Partitioned Partition(absl::Span<const uint128_t> in, size_t bits) {
+  size_t n = in.size();
+  size_t num_parts = size_t{1} << bits;
+  size_t num_chunks = NumChunks(n);
+  size_t chunk = (n + num_chunks - 1) / num_chunks;
+  auto part_of = [bits](uint128_t v) -> size_t {
+    return bits == 0 ? 0 : MixMask(v) >> (64 - bits);
+  };
+
+  std::vector<size_t> hist(num_chunks * num_parts, 0);
+  yacl::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; ++c) {
+      size_t* h = hist.data() + c * num_parts;
+      for (size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i) {
+        h[part_of(in[i])]++;
+      }
+    }
+  });
+
+  // Partition-major exclusive prefix sum: every chunk owns a contiguous
+  // slice of every partition, so the scatter needs no synchronisation.
+  Partitioned out;
+  out.values.resize(n);
+  out.index.resize(n);
+  out.bounds.resize(num_parts + 1);
+  size_t sum = 0;
+  for (size_t p = 0; p < num_parts; ++p) {
+    out.bounds[p] = sum;
+    for (size_t c = 0; c < num_chunks; ++c) {
+      size_t cnt = hist[c * num_parts + p];
+      hist[c * num_parts + p] = sum;
+      sum += cnt;
+    }
+  }
+  out.bounds[num_parts] = sum;
+
+  yacl::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; ++c) {
+      size_t* h = hist.data() + c * num_parts;
+      for (size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i) {
+        size_t pos = h[part_of(in[i])]++;
+        out.values[pos] = in[i];
+        out.index[pos] = static_cast<uint32_t>(i);
+      }
+    }
+  });
+  return out;
+}
+
+}  // namespace
+
+std::vector<uint32_t> IntersectMasks(absl::Span<const uint128_t> table,
+                                     absl::Span<const uint128_t> query) {
+  YACL_ENFORCE(table.size() < kEmpty && query.size() < kEmpty);
+  if (table.empty() || query.empty()) {
+    return {};
+  }
+
+  size_t bits = 0;
+  while (bits < kMaxPartitionBits && (table.size() >> bits) > kPartitionTarget) {
+    ++bits;
+  }
+  auto t = Partition(table, bits);
+  auto q = Partition(query, bits);
+
+  // Query indices are distinct, so the probe threads never write the same
+  // byte.
+  std::vector<uint8_t> hit(query.size(), 0);
+  yacl::parallel_for(0, size_t{1} << bits, 1, [&](int64_t begin, int64_t end) {
+    std::vector<uint32_t> slots;
+    for (int64_t p = begin; p < end; ++p) {
+      size_t tb = t.bounds[p];
+      size_t te = t.bounds[p + 1];
+      if (tb == te) {
+        continue;
+      }
+      size_t cap = 2;
+      while (cap < 2 * (te - tb)) {
+        cap <<= 1;
+      }
+      size_t slot_mask = cap - 1;
+      slots.assign(cap, kEmpty);
+      // Equal values share a probe run, so only the first copy is kept:
+      // inserting every duplicate would make the build quadratic.
+      for (size_t k = tb; k < te; ++k) {
+        size_t s = MixMask(t.values[k]) & slot_mask;
+        while (slots[s] != kEmpty && t.values[slots[s]] != t.values[k]) {
+          s = (s + 1) & slot_mask;
+        }
+        if (slots[s] == kEmpty) {
+          slots[s] = static_cast<uint32_t>(k);
+        }
+      }
+      for (size_t k = q.bounds[p]; k < q.bounds[p + 1]; ++k) {
+        size_t s = MixMask(q.values[k]) & slot_mask;
+        while (slots[s] != kEmpty) {
+          if (t.values[slots[s]] == q.values[k]) {
+            hit[q.index[k]] = 1;
+            break;
+          }
+          s = (s + 1) & slot_mask;
+        }
+      }
+    }
+  });
+
+  // Collect the hits in index order.
+  size_t n = query.size();
+  size_t num_chunks = NumChunks(n);
+  size_t chunk = (n + num_chunks - 1) / num_chunks;
+  std::vector<size_t> offsets(num_chunks + 1, 0);
+  yacl::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; ++c) {
+      size_t cnt = 0;
+      for (size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i) {
+        cnt += hit[i];
+      }
+      offsets[c + 1] = cnt;
+    }
+  });
+  for (size_t c = 0; c < num_chunks; ++c) {
+    offsets[c + 1] += offsets[c];
+  }
+  std::vector<uint32_t> ret(offsets[num_chunks]);
+  yacl::parallel_for(0, num_chunks, 1, [&](int64_t begin, int64_t end) {
+    for (int64_t c = begin; c < end; ++c) {
+      size_t pos = offsets[c];
+      for (size_t i = c * chunk; i < std::min(n, (c + 1) * chunk); ++i) {
+        if (hit[i] != 0) {
+          ret[pos++] = static_cast<uint32_t>(i);
+        }
+      }
+    }
+  });
+  return ret;
+}
+
+}  // namespace examples::psi
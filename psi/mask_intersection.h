@@ -0,0 +1,38 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+
+#include "yacl/base/int128.h"
+
+namespace examples::psi {
+
+// Intersection of fixed-width 128-bit PSI masks.
+//
+// Returns, in increasing order, every index i such that query[i] occurs in
+// table. Both inputs are radix-partitioned on a hash of the mask, and each
+// partition is joined through its own small open-addressing table, so the
+// build and probe phases stay cache resident and run in parallel.
+//
+// Masks are expected to be pseudo-random (OPRF/VOLE outputs), but arbitrary
+// inputs are handled correctly. Duplicates are allowed on both sides.
+std::vector<uint32_t> IntersectMasks(absl::Span<const uint128_t> table,
+                                     absl::Span<const uint128_t> query);
+
+}  // namespace examples::psi
@@ -0,0 +1,70 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <set>
+#include <vector>
+
+#include "examples/psi/mask_intersection.h"
+
+#include "yacl/base/exception.h"
+#include "yacl/crypto/rand/rand.h"
+#include "yacl/crypto/tools/prg.h"
+#include "yacl/utils/parallel.h"
+
+// The std::set join that the VOLE-based protocols used before
+// IntersectMasks.
+std::vector<int32_t> SetIntersection(const std::vector<uint128_t>& x,
+                                     const std::vector<uint128_t>& y) {
+  std::set<uint128_t> set(x.begin(), x.end());
+  std::vector<int32_t> ret(y.size(), -1);
+  yacl::parallel_for(0, y.size(), [&](size_t start, size_t end) {
+    for (size_t i = start; i < end; ++i) {
+      if (set.count(y[i]) != 0) {
+        ret[i] = i;
+      }
+    }
+  });
+  ret.erase(std::remove(ret.begin(), ret.end(), -1), ret.end());
+  return ret;
+}
+
+int main() {
+  std::cout << "log2(n), std::set (s), IntersectMasks (s), intersection size"
+            << std::endl;
+  for (size_t logn = 16; logn <= 26; logn += 2) {
+    size_t n = size_t{1} << logn;
+    std::vector<uint128_t> x(n);
+    std::vector<uint128_t> y(n);
+    yacl::crypto::Prg<uint128_t> prng(yacl::crypto::FastRandU128());
+    prng.Fill(absl::MakeSpan(x));
+    prng.Fill(absl::MakeSpan(y));
+    // half of the masks intersect
+    std::copy(x.begin(), x.begin() + n / 2, y.begin() + n / 4);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    auto z_set = SetIntersection(x, y);
+    auto mid_time = std::chrono::high_resolution_clock::now();
+    auto z = examples::psi::IntersectMasks(x, y);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> set_duration = mid_time - start_time;
+    std::chrono::duration<double> join_duration = end_time - mid_time;
+    YACL_ENFORCE(z.size() == z_set.size());
+    std::cout << logn << ", " << set_duration.count() << ", "
+              << join_duration.count() << ", " << z.size() << std::endl;
+  }
+}
@@ -0,0 +1,95 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/psi/mask_intersection.h"
+
+#include <set>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "yacl/crypto/rand/rand.h"
+
+namespace examples::psi {
+
+namespace {
+std::vector<uint32_t> ReferenceIntersection(const std::vector<uint128_t> &x,
+                                            const std::vector<uint128_t> &y) {
+  std::set<uint128_t> set(x.begin(), x.end());
+  std::vector<uint32_t> ret;
+  for (size_t i = 0; i < y.size(); ++i) {
+    if (set.count(y[i]) != 0) {
+      ret.push_back(i);
+    }
+  }
+  return ret;
+}
+}  // namespace
+
+class MaskIntersectionTest : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(MaskIntersectionTest, Works) {
+  size_t n = GetParam();
+  std::vector<uint128_t> x(n);
+  std::vector<uint128_t> y(n);
+  for (size_t i = 0; i < n; ++i) {
+    x[i] = yacl::crypto::FastRandU128();
+    // every third query mask is shared with the table
+    y[i] = (i % 3 == 0) ? x[(i * 7) % n] : yacl::crypto::FastRandU128();
+  }
+
+  auto z = IntersectMasks(absl::MakeSpan(x), absl::MakeSpan(y));
+  EXPECT_EQ(z, ReferenceIntersection(x, y));
+}
+
+INSTANTIATE_TEST_SUITE_P(Works_Instances, MaskIntersectionTest,
+                         testing::Values(1, 100, 1 << 12, 1 << 16, 1 << 20));
+
+TEST(MaskIntersectionTest, SmallAndDuplicateValues) {
+  // structured, non-random masks with repetitions on both sides
+  std::vector<uint128_t> x = {1, 2, 2, 3, uint128_t(1) << 64, 5};
+  std::vector<uint128_t> y = {0, 2, 2, uint128_t(1) << 64, 4, 5, 1};
+
+  auto z = IntersectMasks(absl::MakeSpan(x), absl::MakeSpan(y));
+  EXPECT_EQ(z, ReferenceIntersection(x, y));
+}
+
+TEST(MaskIntersectionTest, AllEqualTable) {
+  // one value repeated across the whole table lands in a single partition
+  // and probe run; the build must stay linear
+  size_t n = 1 << 20;
+  uint128_t v = yacl::MakeUint128(0x0123456789abcdefULL, 42);
+  std::vector<uint128_t> x(n, v);
+  std::vector<uint128_t> y(1000);
+  for (size_t i = 0; i < y.size(); ++i) {
+    y[i] = (i % 5 == 0) ? v : uint128_t(i);
+  }
+
+  auto z = IntersectMasks(absl::MakeSpan(x), absl::MakeSpan(y));
+  std::vector<uint32_t> expected;
+  for (uint32_t i = 0; i < y.size(); i += 5) {
+    expected.push_back(i);
+  }
+  EXPECT_EQ(z, expected);
+}
+
+TEST(MaskIntersectionTest, EmptyInputs) {
+  std::vector<uint128_t> x = {1, 2, 3};
+  std::vector<uint128_t> empty;
+
+  EXPECT_TRUE(IntersectMasks(absl::MakeSpan(empty), absl::MakeSpan(x)).empty());
+  EXPECT_TRUE(IntersectMasks(absl::MakeSpan(x), absl::MakeSpan(empty)).empty());
+}
+
+}  // namespace examples::psi
@@ -0,0 +1,103 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/psi/mask_packing.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "yacl/base/exception.h"
+#include "yacl/math/gadget.h"
+#include "yacl/utils/parallel.h"
+
+namespace examples::psi {
+
+size_t MaskLength(size_t ssp, size_t n_s, size_t n_r) {
+  size_t bits = ssp + yacl::math::Log2Ceil(std::max<size_t>(n_s, 1)) +
+                yacl::math::Log2Ceil(std::max<size_t>(n_r, 1));
+  return std::min<size_t>(bits, 128);
+}
+
+// Eight consecutive masks always end on a byte boundary, so groups of eight
+// can be packed and unpacked in parallel without sharing a byte.
+
+void PackMasks(absl::Span<const uint128_t> in, size_t bits,
+               absl::Span<uint8_t> out) {
+  YACL_ENFORCE(bits > 0 && bits <= 128);
+  YACL_ENFORCE(out.size() == PackedSize(in.size(), bits));
+  if (bits == 128) {
+    std::memcpy(out.data(), in.data(), out.size());
+    return;
+  }
+  std::memset(out.data(), 0, out.size());
+  uint128_t low = LowBitsMask(bits);
+  size_t num_groups = (in.size() + 7) / 8;
+  yacl::parallel_for(0, num_groups, [&](int64_t begin, int64_t end) {
+    for (int64_t g = begin; g < end; ++g) {
+      for (size_t i = g * 8; i < std::min<size_t>(in.size(), g * 8 + 8); ++i) {
+        size_t offset = i * bits;
+        uint8_t* p = out.data() + offset / 8;
+        size_t s = offset % 8;
+        size_t nbytes = (s + bits + 7) / 8;  // at most 17
+        uint128_t v = in[i] & low;
+        uint128_t lo = v << s;
+        for (size_t k = 0; k < std::min<size_t>(nbytes, 16); ++k) {
+          p[k] |= static_cast<uint8_t>(lo >> (8 * k));
+        }
+        if (nbytes == 17) {
+          p[16] |= static_cast<uint8_t>(v >> (128 - s));
+        }
+      }
+    }
+  });
+}
+
+void UnpackMasks(absl::Span<const uint8_t> in, size_t bits,
+                 absl::Span<uint128_t> out) {
+  YACL_ENFORCE(bits > 0 && bits <= 128);
+  YACL_ENFORCE(in.size() == PackedSize(out.size(), bits));
+  if (bits == 128) {
+    std::memcpy(out.data(), in.data(), in.size());
+    return;
+  }
+  uint128_t low = LowBitsMask(bits);
+  yacl::parallel_for(0, out.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      size_t offset = i * bits;
+      const uint8_t* p = in.data() + offset / 8;
+      size_t s = offset % 8;
+      size_t nbytes = (s + bits + 7) / 8;
+      uint128_t v = 0;
+      for (size_t k = 0; k < std::min<size_t>(nbytes, 16); ++k) {
+        v |= static_cast<uint128_t>(p[k]) << (8 * k);
+      }
+      v >>= s;
+      if (nbytes == 17) {
+        v |= static_cast<uint128_t>(p[16]) << (128 - s);
+      }
+      out[i] = v & low;
+    }
+  });
+}
+
+void TruncateMasks(absl::Span<uint128_t> masks, size_t bits) {
+  uint128_t low = LowBitsMask(bits);
+  yacl::parallel_for(0, masks.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      masks[i] &= low;
+    }
+  });
+}
+
+}  // namespace examples::psi
@@ -0,0 +1,52 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/types/span.h"
+
+#include "yacl/base/int128.h"
+
+namespace examples::psi {
+
+// Number of mask bits needed so that a false positive among n_s * n_r
+// comparisons happens with probability at most 2^-ssp:
+// ssp + ceil(log2(n_s)) + ceil(log2(n_r)), capped at 128.
+size_t MaskLength(size_t ssp, size_t n_s, size_t n_r);
+
+// The low `bits` bits set.
+inline uint128_t LowBitsMask(size_t bits) {
+  return bits >= 128 ? ~uint128_t(0) : (uint128_t(1) << bits) - 1;
+}
+
+// Bytes needed to pack n masks of `bits` bits each.
+inline size_t PackedSize(size_t n, size_t bits) { return (n * bits + 7) / 8; }
+
+// Packs the low `bits` bits of every mask back to back, little-endian, so
+// mask i occupies bits [i * bits, (i + 1) * bits) of out. out must hold
+// PackedSize(in.size(), bits) bytes.
+void PackMasks(absl::Span<const uint128_t> in, size_t bits,
+               absl::Span<uint8_t> out);
+
+// Inverse of PackMasks. The unused high bits of every output are zero.
+void UnpackMasks(absl::Span<const uint8_t> in, size_t bits,
+                 absl::Span<uint128_t> out);
+
+// Clears all but the low `bits` bits of every mask.
+void TruncateMasks(absl::Span<uint128_t> masks, size_t bits);
+
+}  // namespace examples::psi
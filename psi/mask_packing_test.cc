@@ -0,0 +1,53 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/psi/mask_packing.h"
+
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "yacl/crypto/rand/rand.h"
+
+namespace examples::psi {
+
+class MaskPackingTest : public ::testing::TestWithParam<size_t> {};
+
+TEST_P(MaskPackingTest, RoundTrip) {
+  size_t bits = GetParam();
+  for (size_t n : {0, 1, 7, 8, 9, 1000}) {
+    std::vector<uint128_t> x(n);
+    for (auto &v : x) {
+      v = yacl::crypto::FastRandU128();
+    }
+    std::vector<uint8_t> buf(PackedSize(n, bits));
+    PackMasks(absl::MakeSpan(x), bits, absl::MakeSpan(buf));
+    std::vector<uint128_t> y(n);
+    UnpackMasks(absl::MakeSpan(buf), bits, absl::MakeSpan(y));
+
+    TruncateMasks(absl::MakeSpan(x), bits);
+    EXPECT_EQ(x, y);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(RoundTrip_Instances, MaskPackingTest,
+                         testing::Values(1, 8, 13, 64, 65, 88, 127, 128));
+
+TEST(MaskPackingTest, MaskLength) {
+  EXPECT_EQ(MaskLength(40, 1 << 20, 1 << 20), 80);
+  EXPECT_EQ(MaskLength(40, 1 << 24, 3), 66);
+  EXPECT_EQ(MaskLength(40, size_t{1} << 60, size_t{1} << 60), 128);
+}
+
+}  // namespace examples::psi
@@ -0,0 +1,92 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/psi/point_batch.h"
+
+#include <atomic>
+#include <exception>
+#include <functional>
+
+#include "yacl/base/exception.h"
+#include "yacl/utils/parallel.h"
+
+namespace examples::psi {
+
+namespace {
+
+// Runs ok(i) for i in [0, n) in parallel, each task stopping at its first
+// failure, and returns the smallest failing index, or n if none failed. An
+// exception thrown by ok counts as a failure.
+size_t FirstFailure(size_t n, const std::function<bool(size_t)>& ok) {
+  std::atomic<size_t> first{n};
+  yacl::parallel_for(0, n, [&](int64_t begin, int64_t end) {
+    size_t failed = n;
+    for (int64_t i = begin; i < end; ++i) {
+      bool valid = false;
+      try {
+        valid = ok(i);
+      } catch (const std::exception&) {
+        valid = false;
+      }
+      if (!valid) {
+        failed = i;
+        break;
+      }
+    }
+    size_t seen = first.load();
+    while (failed < seen && !first.compare_exchange_weak(seen, failed)) {
+    }
+  });
+  return first.load();
+}
+
+}  // namespace
+
+void SerializePoints(const yc::EcGroup& ec, absl::Span<const yc::EcPoint> in,
+                     size_t point_size, absl::Span<uint8_t> out) {
+  YACL_ENFORCE(out.size() == in.size() * point_size);
+  size_t num_batches = (in.size() + kPointBatchSize - 1) / kPointBatchSize;
+  yacl::parallel_for(0, num_batches, [&](int64_t begin, int64_t end) {
+    for (int64_t b = begin; b < end; ++b) {
+      size_t first = b * kPointBatchSize;
+      auto batch = in.subspan(first, kPointBatchSize);
+      for (size_t i = 0; i < batch.size(); ++i) {
+        ec.SerializePoint(batch[i], out.data() + (first + i) * point_size,
+                          point_size);
+      }
+    }
+  });
+}
+
+void DeserializePoints(const yc::EcGroup& ec, absl::Span<const uint8_t> in,
+                       size_t point_size, absl::Span<yc::EcPoint> out) {
+  YACL_ENFORCE(in.size() == out.size() * point_size);
+  size_t bad = FirstFailure(out.size(), [&](size_t i) {
+    out[i] = ec.DeserializePoint(
+        yacl::ByteContainerView(in.data() + i * point_size, point_size));
+    return true;
+  });
+  YACL_ENFORCE(bad == out.size(), "point {} of {} cannot be decoded", bad,
+               out.size());
+}
+
+void CheckPointsInGroup(const yc::EcGroup& ec,
+                        absl::Span<const yc::EcPoint> points) {
+  size_t bad = FirstFailure(
+      points.size(), [&](size_t i) { return ec.IsInCurveGroup(points[i]); });
+  YACL_ENFORCE(bad == points.size(), "point {} of {} is not in the group",
+               bad, points.size());
+}
+
+}  // namespace examples::psi
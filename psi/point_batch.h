@@ -0,0 +1,50 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "absl/types/span.h"
+
+#include "yacl/crypto/ecc/ec_point.h"
+#include "yacl/crypto/ecc/ecc_spi.h"
+
+namespace examples::psi {
+
+namespace yc = yacl::crypto;
+
+// Points serialized by one task.
+inline constexpr size_t kPointBatchSize = 1024;
+
+// Serializes in[i] into out[i * point_size, (i + 1) * point_size), in
+// parallel over batches of kPointBatchSize points.
+void SerializePoints(const yc::EcGroup& ec, absl::Span<const yc::EcPoint> in,
+                     size_t point_size, absl::Span<uint8_t> out);
+
+// Inverse of SerializePoints. Throws, naming the first bad index, if an
+// encoding cannot be decoded.
+void DeserializePoints(const yc::EcGroup& ec, absl::Span<const uint8_t> in,
+                       size_t point_size, absl::Span<yc::EcPoint> out);
+
+// Throws, naming the first bad index, unless every point is in the group.
+// Decoding alone does not guarantee this for every curve (FourQ decodes
+// small-subgroup points), so every example calls it after DeserializePoints
+// on points received from a peer.
+// point_batch_bench reports its cost next to DeserializePoints.
+void CheckPointsInGroup(const yc::EcGroup& ec,
+                        absl::Span<const yc::EcPoint> points);
+
+}  // namespace examples::psi
@@ -0,0 +1,58 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "examples/psi/point_batch.h"
+
+#include "yacl/crypto/rand/rand.h"
+
+// Serialization, deserialization and group membership check throughput per
+// curve.
+int main() {
+  size_t n = size_t{1} << 16;
+  std::cout << "curve, SerializePoints (points/s), DeserializePoints "
+               "(points/s), CheckPointsInGroup (points/s)"
+            << std::endl;
+  for (std::string curve : {"FourQ", "secp256k1", "sm2"}) {
+    auto ec = yacl::crypto::EcGroupFactory::Instance().Create(curve);
+    size_t point_size = ec->GetSerializeLength();
+    std::vector<yacl::crypto::EcPoint> points(n);
+    for (size_t i = 0; i < n; ++i) {
+      points[i] = ec->MulBase(yacl::math::MPInt(yacl::crypto::FastRandU64()));
+    }
+    std::vector<uint8_t> buffer(n * point_size);
+    std::vector<yacl::crypto::EcPoint> decoded(n);
+
+    auto start_time = std::chrono::high_resolution_clock::now();
+    examples::psi::SerializePoints(*ec, points, point_size,
+                                   absl::MakeSpan(buffer));
+    auto mid_time = std::chrono::high_resolution_clock::now();
+    examples::psi::DeserializePoints(*ec, buffer, point_size,
+                                     absl::MakeSpan(decoded));
+    auto check_time = std::chrono::high_resolution_clock::now();
+    examples::psi::CheckPointsInGroup(*ec, decoded);
+    auto end_time = std::chrono::high_resolution_clock::now();
+
+    std::chrono::duration<double> ser_duration = mid_time - start_time;
+    std::chrono::duration<double> de_duration = check_time - mid_time;
+    std::chrono::duration<double> check_duration = end_time - check_time;
+    std::cout << curve << ", " << n / ser_duration.count() << ", "
+              << n / de_duration.count() << ", " << n / check_duration.count()
+              << std::endl;
+  }
+}
@@ -0,0 +1,78 @@
+// Copyright 2024 Guowei Ling.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/psi/point_batch.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "yacl/crypto/rand/rand.h"
+
+namespace examples::psi {
+
+class PointBatchTest : public ::testing::TestWithParam<std::string> {};
+
+TEST_P(PointBatchTest, RoundTrip) {
+  auto ec = yc::EcGroupFactory::Instance().Create(GetParam());
+  size_t point_size = ec->GetSerializeLength();
+  // more than one batch, and a partial last batch
+  size_t n = 2 * kPointBatchSize + 17;
+  std::vector<yc::EcPoint> points(n);
+  for (size_t i = 0; i < n; ++i) {
+    points[i] = ec->MulBase(yacl::math::MPInt(yacl::crypto::FastRandU64()));
+  }
+
+  std::vector<uint8_t> buffer(n * point_size);
+  SerializePoints(*ec, points, point_size, absl::MakeSpan(buffer));
+  for (size_t i = 0; i < n; i += 101) {
+    auto expected = ec->SerializePoint(points[i]);
+    ASSERT_EQ(expected.size(), int64_t(point_size));
+    EXPECT_EQ(std::memcmp(expected.data(), buffer.data() + i * point_size,
+                          point_size),
+              0);
+  }
+
+  std::vector<yc::EcPoint> decoded(n);
+  DeserializePoints(*ec, buffer, point_size, absl::MakeSpan(decoded));
+  for (size_t i = 0; i < n; ++i) {
+    EXPECT_TRUE(ec->PointEqual(points[i], decoded[i]));
+  }
+  EXPECT_NO_THROW(CheckPointsInGroup(*ec, decoded));
+}
+
+INSTANTIATE_TEST_SUITE_P(Curves, PointBatchTest,
+                         testing::Values("FourQ", "secp256k1", "sm2"));
+
+TEST(PointBatchTest, RejectsInvalidPoint) {
+  auto ec = yc::EcGroupFactory::Instance().Create("secp256k1");
+  size_t point_size = ec->GetSerializeLength();
+  size_t n = 100;
+  std::vector<yc::EcPoint> points(n);
+  for (size_t i = 0; i < n; ++i) {
+    points[i] = ec->MulBase(yacl::math::MPInt(i + 1));
+  }
+  std::vector<uint8_t> buffer(n * point_size);
+  SerializePoints(*ec, points, point_size, absl::MakeSpan(buffer));
+  // not a valid SEC1 prefix
+  buffer[42 * point_size] = 0x05;
+
+  std::vector<yc::EcPoint> decoded(n);
+  EXPECT_ANY_THROW(
+      DeserializePoints(*ec, buffer, point_size, absl::MakeSpan(decoded)));
+}
+
+}  // namespace examples::psi
@@ -1,8 +1,16 @@
+#include <algorithm>
+#include <chrono>
+#include <future>
 #include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
 #include <vector>
 
 #include "examples/okvs/baxos.h"
 #include "examples/okvs/galois128.h"
+#include "examples/psi/mask_intersection.h"
+#include "examples/psi/mask_packing.h"
 
 #include "yacl/base/int128.h"
 #include "yacl/kernel/algorithms/silent_vole.h"
@@ -14,21 +22,8 @@ using namespace std;
 
 inline std::vector<int32_t> GetIntersectionIdx(
     const std::vector<uint128_t>& x, const std::vector<uint128_t>& y) {
-  std::set<uint128_t> set(x.begin(), x.end());
-  std::vector<int32_t> ret(y.size(), -1);  // 初始化为 -1
-
-  yacl::parallel_for(0, y.size(), [&](size_t start, size_t end) {
-    for (size_t i = start; i < end; ++i) {
-      if (set.count(y[i]) != 0) {
-        ret[i] = i;
-      }
-    }
-  });
-
-  // 清除所有值为 -1 的元素
-  ret.erase(std::remove(ret.begin(), ret.end(), -1), ret.end());
-
-  return ret;
+  auto idx = examples::psi::IntersectMasks(x, y);
+  return std::vector<int32_t>(idx.begin(), idx.end());
 }
 
 std::vector<uint128_t> CreateRangeItems(size_t begin, size_t size) {
@@ -39,59 +34,153 @@ std::vector<uint128_t> CreateRangeItems(size_t begin, size_t size) {
   return ret;
 }
 
+// Wall-clock intervals of named protocol phases, relative to construction.
+class PhaseTimeline {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  PhaseTimeline() : origin_(Clock::now()) {}
+
+  // Runs fn and records how long it took. Safe to call from several threads.
+  template <typename F>
+  void Time(const std::string& phase, F&& fn) {
+    auto begin = Clock::now();
+    fn();
+    auto end = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    phases_.push_back({phase, Seconds(begin), Seconds(end)});
+  }
+
+  void Print(const std::string& party) const {
+    auto phases = phases_;
+    std::sort(phases.begin(), phases.end(),
+              [](const Phase& a, const Phase& b) { return a.begin < b.begin; });
+    for (const auto& phase : phases) {
+      std::cout << "[" << party << "] " << phase.name << ": " << phase.begin
+                << "s -> " << phase.end << "s" << std::endl;
+    }
+  }
+
+ private:
+  struct Phase {
+    std::string name;
+    double begin;
+    double end;
+  };
+
+  double Seconds(Clock::time_point t) const {
+    return std::chrono::duration<double>(t - origin_).count();
+  }
+
+  Clock::time_point origin_;
+  std::mutex mutex_;
+  std::vector<Phase> phases_;
+};
+
+// mask_bits is the length of the sender masks on the wire. The receiver
+// fixes it, deriving it from baxos.ssp_ and both set sizes when 0, and sends
+// it to the sender. A nonzero mask_bits on the sender must match.
+//
+// Solve does not depend on the VOLE output, so with overlap_vole the silent
+// VOLE and Baxos::Solve run concurrently. The VOLE always runs on the yacl
+// thread pool and Solve on solve_threads threads of its own, whether or not
+// the two overlap. solve_threads = 0 means a single thread, as before.
 std::vector<int32_t> RR22PsiRecv(
     const std::shared_ptr<yacl::link::Context>& ctx,
-    std::vector<uint128_t>& elem_hashes, okvs::Baxos baxos) {
+    std::vector<uint128_t>& elem_hashes, okvs::Baxos baxos,
+    size_t mask_bits = 0, bool overlap_vole = true, size_t solve_threads = 0) {
+  PhaseTimeline timeline;
   uint128_t okvssize = baxos.size();
+  size_t sender_size =
+      DeserializeUint128(ctx->Recv(ctx->PrevRank(), "sender size"));
+  if (mask_bits == 0) {
+    mask_bits =
+        examples::psi::MaskLength(baxos.ssp_, sender_size, elem_hashes.size());
+  }
+  solve_threads = std::max<size_t>(1, solve_threads);
 
   // VOLE
   ctx->SendAsync(ctx->NextRank(), yacl::SerializeUint128(okvssize),
                  "baxos.size");
+  ctx->SendAsync(ctx->NextRank(), yacl::SerializeUint128(mask_bits),
+                 "mask bits");
 
   // VOLE
   const auto codetype = yacl::crypto::CodeType::ExAcc11;
   std::vector<uint128_t> a(okvssize);
   std::vector<uint128_t> c(okvssize);
-  auto volereceiver = std::async([&] {
-    auto sv_receiver = yacl::crypto::SilentVoleReceiver(codetype);
-    sv_receiver.Recv(ctx, absl::MakeSpan(a), absl::MakeSpan(c));
+  auto volereceiver = std::async(std::launch::async, [&] {
+    timeline.Time("vole", [&] {
+      auto sv_receiver = yacl::crypto::SilentVoleReceiver(codetype);
+      sv_receiver.Recv(ctx, absl::MakeSpan(a), absl::MakeSpan(c));
+    });
   });
-  volereceiver.get();
+  if (!overlap_vole) {
+    volereceiver.get();
+  }
 
   // Encode
   std::vector<uint128_t> p(okvssize);
-  baxos.Solve(absl::MakeSpan(elem_hashes), absl::MakeSpan(elem_hashes),
-              absl::MakeSpan(p));
+  timeline.Time("solve", [&] {
+    baxos.Solve(absl::MakeSpan(elem_hashes), absl::MakeSpan(elem_hashes),
+                absl::MakeSpan(p), nullptr, solve_threads);
+  });
+  if (overlap_vole) {
+    volereceiver.get();
+  }
 
   std::vector<uint128_t> aprime(okvssize);
-
-  yacl::parallel_for(0, okvssize, [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      aprime[idx] = a[idx] ^ p[idx];
-    }
+  timeline.Time("send A'", [&] {
+    yacl::parallel_for(0, okvssize, [&](int64_t begin, int64_t end) {
+      for (int64_t idx = begin; idx < end; ++idx) {
+        aprime[idx] = a[idx] ^ p[idx];
+      }
+    });
+    ctx->SendAsync(ctx->NextRank(),
+                   yacl::ByteContainerView(aprime.data(),
+                                           aprime.size() * sizeof(uint128_t)),
+                   "Send A' = P+A");
   });
-  ctx->SendAsync(
-      ctx->NextRank(),
-      yacl::ByteContainerView(aprime.data(), aprime.size() * sizeof(uint128_t)),
-      "Send A' = P+A");
   std::vector<uint128_t> receivermasks(elem_hashes.size());
-  baxos.Decode(absl::MakeSpan(elem_hashes), absl::MakeSpan(receivermasks),
-               absl::MakeSpan(c));
-  std::vector<uint128_t> sendermasks(elem_hashes.size());
-  auto buf = ctx->Recv(ctx->PrevRank(), "Receive masks of sender");
-  YACL_ENFORCE(buf.size() == int64_t(elem_hashes.size() * sizeof(uint128_t)));
-  std::memcpy(sendermasks.data(), buf.data(), buf.size());
+  timeline.Time("decode", [&] {
+    baxos.Decode(absl::MakeSpan(elem_hashes), absl::MakeSpan(receivermasks),
+                 absl::MakeSpan(c));
+    examples::psi::TruncateMasks(absl::MakeSpan(receivermasks), mask_bits);
+  });
+  std::vector<uint128_t> sendermasks(sender_size);
+  timeline.Time("recv masks", [&] {
+    auto buf = ctx->Recv(ctx->PrevRank(), "Receive masks of sender");
+    YACL_ENFORCE(buf.size() ==
+                 int64_t(examples::psi::PackedSize(sender_size, mask_bits)));
+    examples::psi::UnpackMasks(
+        absl::MakeConstSpan(buf.data<uint8_t>(), buf.size()), mask_bits,
+        absl::MakeSpan(sendermasks));
+  });
 
-  auto z = GetIntersectionIdx(sendermasks, receivermasks);
-  std::cout << sendermasks[0] << std::endl;
-  std::cout << receivermasks[0] << std::endl;
+  std::vector<int32_t> z;
+  timeline.Time("intersect",
+                [&] { z = GetIntersectionIdx(sendermasks, receivermasks); });
+  timeline.Print("receiver");
   return z;
 }
 
+// Items per task of the fused sender decode; each task runs its own
+// Baxos::Decode over a contiguous range of the sender's items.
+constexpr size_t kSenderDecodeGrain = size_t{1} << 16;
+
 void RR22PsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
-                 std::vector<uint128_t>& elem_hashes, okvs::Baxos baxos) {
+                 std::vector<uint128_t>& elem_hashes, okvs::Baxos baxos,
+                 size_t mask_bits = 0, bool fused_decode = true) {
+  ctx->SendAsync(ctx->NextRank(), yacl::SerializeUint128(elem_hashes.size()),
+                 "sender size");
   size_t okvssize =
       DeserializeUint128(ctx->Recv(ctx->PrevRank(), "baxos.size"));
+  size_t recv_mask_bits =
+      DeserializeUint128(ctx->Recv(ctx->PrevRank(), "mask bits"));
+  YACL_ENFORCE(mask_bits == 0 || mask_bits == recv_mask_bits,
+               "mask_bits {} does not match the receiver's {}", mask_bits,
+               recv_mask_bits);
+  mask_bits = recv_mask_bits;
   const auto codetype = yacl::crypto::CodeType::ExAcc11;
   std::vector<uint128_t> b(okvssize);
   uint128_t delta = 0;
@@ -101,37 +190,64 @@ void RR22PsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
     delta = sv_sender.GetDelta();
   });
   volesender.get();
-  std::vector<uint128_t> aprime(okvssize);
   auto buf = ctx->Recv(ctx->PrevRank(), "Receive A' = P+A");
   YACL_ENFORCE(buf.size() == int64_t(okvssize * sizeof(uint128_t)));
-  std::memcpy(aprime.data(), buf.data(), buf.size());
   okvs::Galois128 delta_gf128(delta);
-  std::vector<uint128_t> k(okvssize);
-  yacl::parallel_for(0, okvssize, [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      k[idx] = b[idx] ^ (delta_gf128 * aprime[idx]).get<uint128_t>(0);
-    }
-  });
+  size_t mask_bytes = examples::psi::PackedSize(elem_hashes.size(), mask_bits);
+  if (!fused_decode) {
+    std::vector<uint128_t> aprime(okvssize);
+    std::memcpy(aprime.data(), buf.data(), buf.size());
+    std::vector<uint128_t> k(okvssize);
+    yacl::parallel_for(0, okvssize, [&](int64_t begin, int64_t end) {
+      for (int64_t idx = begin; idx < end; ++idx) {
+        k[idx] = b[idx] ^ (delta_gf128 * aprime[idx]).get<uint128_t>(0);
+      }
+    });
+    std::vector<uint128_t> sendermasks(elem_hashes.size());
+    baxos.Decode(absl::MakeSpan(elem_hashes), absl::MakeSpan(sendermasks),
+                 absl::MakeSpan(k));
+    yacl::parallel_for(0, elem_hashes.size(), [&](int64_t begin, int64_t end) {
+      for (int64_t idx = begin; idx < end; ++idx) {
+        sendermasks[idx] = sendermasks[idx] ^
+                           (delta_gf128 * elem_hashes[idx]).get<uint128_t>(0);
+      }
+    });
+    std::vector<uint8_t> packed(mask_bytes);
+    examples::psi::PackMasks(sendermasks, mask_bits, absl::MakeSpan(packed));
+    ctx->SendAsync(ctx->NextRank(),
+                   yacl::ByteContainerView(packed.data(), packed.size()),
+                   "Send masks of sender");
+    return;
+  }
+
+  // Decode is linear, so Decode(b ^ Δ·A') = Decode(b) ^ Δ·Decode(A'): A' is
+  // decoded in place from the receive buffer, corrected by H(x) and Δ at the
+  // decoded positions only, and Decode(b) is accumulated on top. No
+  // OKVS-sized vector besides b is materialized.
+  absl::Span<uint128_t> aprime(buf.data<uint128_t>(), okvssize);
+  okvs::Baxos accumulate = baxos;
+  accumulate.add_to_decode_ = true;
   std::vector<uint128_t> sendermasks(elem_hashes.size());
-  baxos.Decode(absl::MakeSpan(elem_hashes), absl::MakeSpan(sendermasks),
-               absl::MakeSpan(k));
-  yacl::parallel_for(0, elem_hashes.size(), [&](int64_t begin, int64_t end) {
-    for (int64_t idx = begin; idx < end; ++idx) {
-      sendermasks[idx] =
-          sendermasks[idx] ^ (delta_gf128 * elem_hashes[idx]).get<uint128_t>(0);
-    }
-  });
-  ctx->SendAsync(
-      ctx->NextRank(),
-      yacl::ByteContainerView(sendermasks.data(),
-                              sendermasks.size() * sizeof(uint128_t)),
-      "Send masks of sender");
+  yacl::parallel_for(
+      0, elem_hashes.size(), kSenderDecodeGrain,
+      [&](int64_t begin, int64_t end) {
+        auto in = absl::MakeSpan(elem_hashes).subspan(begin, end - begin);
+        auto out = absl::MakeSpan(sendermasks).subspan(begin, end - begin);
+        baxos.Decode(in, out, aprime);
+        for (size_t idx = 0; idx < out.size(); ++idx) {
+          out[idx] = (delta_gf128 * (out[idx] ^ in[idx])).get<uint128_t>(0);
+        }
+        accumulate.Decode(in, out, absl::MakeSpan(b));
+      });
+  yacl::Buffer packed(mask_bytes);
+  examples::psi::PackMasks(sendermasks, mask_bits,
+                           absl::MakeSpan(packed.data<uint8_t>(), mask_bytes));
+  ctx->SendAsync(ctx->NextRank(), std::move(packed), "Send masks of sender");
 }
 
-int main() {
+void RunRR22(uint64_t num, size_t mask_bits) {
   // 确保链接上下文定义正确
   // 准备OKVS的参数
-  const uint64_t num = 1 << 10;
   size_t bin_size = num;
   size_t weight = 3;
   // statistical security parameter
@@ -149,6 +265,9 @@ int main() {
              seed);
 
   SPDLOG_INFO("baxos.size(): {}", baxos.size());
+  SPDLOG_INFO("mask_bits: {}",
+              mask_bits == 0 ? examples::psi::MaskLength(ssp, num, num)
+                             : mask_bits);
 
   std::vector<uint128_t> items_a = CreateRangeItems(0, num);
   std::vector<uint128_t> items_b = CreateRangeItems(0, num);
@@ -157,12 +276,14 @@ int main() {
 
   auto start_time = std::chrono::high_resolution_clock::now();
 
-  std::future<void> rr22_sender = std::async(
-      std::launch::async, [&] { RR22PsiSend(lctxs[0], items_a, baxos); });
+  std::future<void> rr22_sender = std::async(std::launch::async, [&] {
+    RR22PsiSend(lctxs[0], items_a, baxos, mask_bits);
+  });
 
   std::future<std::vector<int32_t>> rr22_receiver =
-      std::async(std::launch::async,
-                 [&] { return RR22PsiRecv(lctxs[1], items_b, baxos); });
+      std::async(std::launch::async, [&] {
+        return RR22PsiRecv(lctxs[1], items_b, baxos, mask_bits);
+      });
 
   rr22_sender.get();
   auto psi_result = rr22_receiver.get();
@@ -194,3 +315,101 @@ int main() {
                    bytesToMB(receiver_stats->recv_bytes.load())
             << " MB" << std::endl;
 }
+
+// Receiver latency with the VOLE and the OKVS solve run one after the other
+// against running them concurrently. Both modes use the same thread budgets
+// (the yacl pool for the VOLE, solve_threads for Solve), so the difference is
+// the overlap alone.
+void RunReceiverOverlapBench() {
+  size_t weight = 3;
+  size_t ssp = 40;
+  size_t hw = std::max<size_t>(1, std::thread::hardware_concurrency());
+  std::cout << "vole pool threads: " << yacl::get_num_threads() << std::endl;
+  std::cout << "log2(n), solve threads, sequential (s), overlapped (s)"
+            << std::endl;
+  for (size_t logn : {20, 22, 24}) {
+    uint64_t num = uint64_t(1) << logn;
+    okvs::Baxos baxos;
+    uint128_t seed = yacl::crypto::FastRandU128();
+    baxos.Init(num, num, weight, ssp, okvs::PaxosParam::DenseType::GF128,
+               seed);
+    std::vector<uint128_t> items_a = CreateRangeItems(0, num);
+    std::vector<uint128_t> items_b = CreateRangeItems(0, num);
+    for (size_t solve_threads : {size_t{1}, hw}) {
+      double latency[2];
+      for (bool overlap : {false, true}) {
+        auto lctxs = yacl::link::test::SetupWorld(2);  // setup network
+        std::future<void> rr22_sender =
+            std::async(std::launch::async,
+                       [&] { RR22PsiSend(lctxs[0], items_a, baxos); });
+        std::future<double> rr22_receiver =
+            std::async(std::launch::async, [&] {
+              auto start_time = std::chrono::high_resolution_clock::now();
+              RR22PsiRecv(lctxs[1], items_b, baxos, 0, overlap,
+                          solve_threads);
+              std::chrono::duration<double> duration =
+                  std::chrono::high_resolution_clock::now() - start_time;
+              return duration.count();
+            });
+        rr22_sender.get();
+        latency[overlap] = rr22_receiver.get();
+      }
+      std::cout << logn << ", " << solve_threads << ", " << latency[0] << ", "
+                << latency[1] << std::endl;
+      if (hw == 1) {
+        break;
+      }
+    }
+  }
+}
+
+// Sender latency of the fused decode against materializing A' and
+// k = b ^ Δ·A' before decoding, and the sender memory the fusion saves: the
+// unfused path copies A' out of the receive buffer and fills k, one OKVS-sized
+// vector each, while the fused path decodes A' in place. b, the receive
+// buffer and the masks are allocated alike by both.
+void RunSenderDecodeBench() {
+  size_t weight = 3;
+  size_t ssp = 40;
+  std::cout << "log2(n), sender memory saved (MB), unfused (s), fused (s)"
+            << std::endl;
+  for (size_t logn : {20, 22, 24}) {
+    uint64_t num = uint64_t(1) << logn;
+    okvs::Baxos baxos;
+    uint128_t seed = yacl::crypto::FastRandU128();
+    baxos.Init(num, num, weight, ssp, okvs::PaxosParam::DenseType::GF128,
+               seed);
+    std::vector<uint128_t> items_a = CreateRangeItems(0, num);
+    std::vector<uint128_t> items_b = CreateRangeItems(0, num);
+    double latency[2];
+    for (bool fused : {false, true}) {
+      auto lctxs = yacl::link::test::SetupWorld(2);  // setup network
+      std::future<double> rr22_sender = std::async(std::launch::async, [&] {
+        auto start_time = std::chrono::high_resolution_clock::now();
+        RR22PsiSend(lctxs[0], items_a, baxos, 0, fused);
+        std::chrono::duration<double> duration =
+            std::chrono::high_resolution_clock::now() - start_time;
+        return duration.count();
+      });
+      std::future<std::vector<int32_t>> rr22_receiver =
+          std::async(std::launch::async,
+                     [&] { return RR22PsiRecv(lctxs[1], items_b, baxos); });
+      latency[fused] = rr22_sender.get();
+      YACL_ENFORCE(rr22_receiver.get().size() == num);
+    }
+    // the copy of A' and k
+    double saved_mb =
+        static_cast<double>(2 * baxos.size() * sizeof(uint128_t)) /
+        (1024 * 1024);
+    std::cout << logn << ", " << saved_mb << ", " << latency[0] << ", "
+              << latency[1] << std::endl;
+  }
+}
+
+int main() {
+  // full 128-bit masks against the default ssp-derived mask length
+  RunRR22(1 << 20, 128);
+  RunRR22(1 << 20, 0);
+  RunReceiverOverlapBench();
+  RunSenderDecodeBench();
+}
@@ -0,0 +1,51 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/ecdhpsi/file_sync.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "yacl/base/exception.h"
+
+void WriteFully(int fd, const void* data, size_t size,
+                const std::string& path) {
+  const char* p = static_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t n = ::write(fd, p, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    YACL_ENFORCE(n > 0, "cannot write {}: {}", path, std::strerror(errno));
+    p += n;
+    size -= n;
+  }
+}
+
+void SyncFile(int fd, const std::string& path) {
+  YACL_ENFORCE(::fsync(fd) == 0, "cannot sync {}: {}", path,
+               std::strerror(errno));
+}
+
+void SyncDir(const std::string& dir) {
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+  YACL_ENFORCE(fd >= 0, "cannot open {}: {}", dir, std::strerror(errno));
+  int ret = ::fsync(fd);
+  int err = errno;
+  ::close(fd);
+  YACL_ENFORCE(ret == 0, "cannot sync {}: {}", dir, std::strerror(err));
+}
@@ -0,0 +1,29 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// Helpers for files that must survive a crash. All of them throw on error.
+
+// Writes size bytes to fd, retrying short and interrupted writes.
+void WriteFully(int fd, const void* data, size_t size, const std::string& path);
+
+// Flushes fd to stable storage.
+void SyncFile(int fd, const std::string& path);
+
+// Flushes dir itself, which makes a create or rename inside it durable.
+void SyncDir(const std::string& dir);
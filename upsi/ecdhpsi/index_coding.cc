@@ -0,0 +1,87 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/ecdhpsi/index_coding.h"
+
+namespace {
+
+size_t VarintSize(uint64_t v) {
+  size_t n = 1;
+  while (v >= 0x80) {
+    v >>= 7;
+    ++n;
+  }
+  return n;
+}
+
+}  // namespace
+
+yacl::Buffer EncodeIndices(absl::Span<const uint32_t> indices,
+                           size_t universe) {
+  size_t varint_size = 0;
+  uint64_t next = 0;
+  for (uint32_t index : indices) {
+    YACL_ENFORCE(index >= next && index < universe,
+                 "indices must be increasing and below {}", universe);
+    varint_size += VarintSize(index - next);
+    next = uint64_t{index} + 1;
+  }
+  size_t bitmap_size = (universe + 7) / 8;
+  uint8_t kind = bitmap_size < varint_size ? kIndexBitmap : kIndexVarint;
+  size_t payload_size = kind == kIndexBitmap ? bitmap_size : varint_size;
+
+  yacl::Buffer buf(static_cast<int64_t>(kIndexHeaderSize + payload_size));
+  uint8_t* out = buf.data<uint8_t>();
+  uint32_t count = indices.size();
+  out[0] = kind;
+  std::memcpy(out + 1, &count, sizeof(count));
+  out += kIndexHeaderSize;
+  if (kind == kIndexBitmap) {
+    std::memset(out, 0, bitmap_size);
+    for (uint32_t index : indices) {
+      out[index / 8] |= uint8_t{1} << (index % 8);
+    }
+    return buf;
+  }
+  next = 0;
+  for (uint32_t index : indices) {
+    uint64_t gap = index - next;
+    while (gap >= 0x80) {
+      *out++ = static_cast<uint8_t>(gap | 0x80);
+      gap >>= 7;
+    }
+    *out++ = static_cast<uint8_t>(gap);
+    next = uint64_t{index} + 1;
+  }
+  return buf;
+}
+
+size_t DecodedIndexCount(yacl::ByteContainerView in, size_t universe) {
+  YACL_ENFORCE(in.size() >= kIndexHeaderSize,
+               "index message of {} bytes has no header", in.size());
+  uint32_t count;
+  std::memcpy(&count, in.data() + 1, sizeof(count));
+  YACL_ENFORCE(count <= universe, "{} indices out of {}", count, universe);
+  // every varint takes at least one byte
+  YACL_ENFORCE(in[0] != kIndexVarint || count <= in.size() - kIndexHeaderSize,
+               "{} indices in {} varint bytes", count,
+               in.size() - kIndexHeaderSize);
+  return count;
+}
+
+void DecodeIndices(yacl::ByteContainerView in, size_t universe,
+                   absl::Span<uint32_t> out) {
+  YACL_ENFORCE(out.size() == DecodedIndexCount(in, universe));
+  ForEachIndex(in, universe, [&](size_t i, uint32_t index) { out[i] = index; });
+}
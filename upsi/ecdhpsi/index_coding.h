@@ -0,0 +1,96 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "absl/types/span.h"
+
+#include "yacl/base/buffer.h"
+#include "yacl/base/byte_container_view.h"
+#include "yacl/base/exception.h"
+
+// Wire format of the intersection indices EcdhSender returns: a strictly
+// increasing subset of [0, universe), where universe is the receiver's set
+// size.
+//
+// A 5-byte header (kind, u32 count) is followed by either the gaps between
+// consecutive indices minus one as LEB128 varints, or a bitmap of
+// ceil(universe / 8) bytes, whichever is shorter. Sparse results cost about
+// one byte per index, dense ones one bit per receiver item, against four
+// bytes per index plus a separate size message before.
+inline constexpr uint8_t kIndexVarint = 0;
+inline constexpr uint8_t kIndexBitmap = 1;
+inline constexpr size_t kIndexHeaderSize = 1 + sizeof(uint32_t);
+
+yacl::Buffer EncodeIndices(absl::Span<const uint32_t> indices,
+                           size_t universe);
+
+// Number of indices in an encoded message. Throws if the header count is more
+// than universe or than the payload can hold, so callers can size buffers by
+// it before decoding.
+size_t DecodedIndexCount(yacl::ByteContainerView in, size_t universe);
+
+// Calls fn(i, index) for the i-th index in increasing order, straight from the
+// message. Throws if it is malformed or an index is out of [0, universe).
+template <typename F>
+void ForEachIndex(yacl::ByteContainerView in, size_t universe, F&& fn) {
+  size_t count = DecodedIndexCount(in, universe);
+  const uint8_t* data = in.data() + kIndexHeaderSize;
+  size_t size = in.size() - kIndexHeaderSize;
+  if (in[0] == kIndexBitmap) {
+    YACL_ENFORCE(size == (universe + 7) / 8, "bitmap of {} bytes for {} items",
+                 size, universe);
+    size_t i = 0;
+    for (size_t word = 0; word * 8 < size; ++word) {
+      uint64_t bits = 0;
+      std::memcpy(&bits, data + word * 8, std::min<size_t>(8, size - word * 8));
+      while (bits != 0) {
+        size_t index = word * 64 + __builtin_ctzll(bits);
+        YACL_ENFORCE(i < count && index < universe, "malformed index bitmap");
+        fn(i++, static_cast<uint32_t>(index));
+        bits &= bits - 1;
+      }
+    }
+    YACL_ENFORCE(i == count, "index bitmap holds {} of {} indices", i, count);
+    return;
+  }
+  YACL_ENFORCE(in[0] == kIndexVarint, "unknown index encoding {}", in[0]);
+  size_t pos = 0;
+  uint64_t next = 0;
+  for (size_t i = 0; i < count; ++i) {
+    uint64_t gap = 0;
+    for (int shift = 0;; shift += 7) {
+      YACL_ENFORCE(pos < size && shift < 35, "truncated index varint");
+      uint8_t byte = data[pos++];
+      gap |= uint64_t{byte & 0x7fU} << shift;
+      if ((byte & 0x80) == 0) {
+        break;
+      }
+    }
+    next += gap;
+    YACL_ENFORCE(next < universe, "index {} out of {}", next, universe);
+    fn(i, static_cast<uint32_t>(next));
+    ++next;
+  }
+  YACL_ENFORCE(pos == size, "{} trailing bytes after indices", size - pos);
+}
+
+// Decodes into out, which must hold DecodedIndexCount(in, universe) entries.
+void DecodeIndices(yacl::ByteContainerView in, size_t universe,
+                   absl::Span<uint32_t> out);
@@ -0,0 +1,190 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/ecdhpsi/index_coding.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+std::vector<uint8_t> Encode(const std::vector<uint32_t>& indices,
+                            size_t universe) {
+  yacl::Buffer buf = EncodeIndices(absl::MakeConstSpan(indices), universe);
+  const uint8_t* data = buf.data<uint8_t>();
+  return std::vector<uint8_t>(data, data + buf.size());
+}
+
+std::vector<uint32_t> Decode(const std::vector<uint8_t>& in, size_t universe) {
+  std::vector<uint32_t> out(DecodedIndexCount(in, universe));
+  DecodeIndices(in, universe, absl::MakeSpan(out));
+  return out;
+}
+
+std::vector<uint8_t> Header(uint8_t kind, uint32_t count) {
+  std::vector<uint8_t> out(kIndexHeaderSize);
+  out[0] = kind;
+  std::memcpy(out.data() + 1, &count, sizeof(count));
+  return out;
+}
+
+}  // namespace
+
+TEST(IndexCodingTest, SparseIndicesUseVarints) {
+  // gaps of 0, 127, 128 and 2^21 cover one to four byte varints
+  std::vector<uint32_t> indices = {0, 128, 257, 257 + (1 << 21) + 1,
+                                   (1 << 22) - 1};
+  size_t universe = 1 << 22;
+  auto encoded = Encode(indices, universe);
+  EXPECT_EQ(encoded[0], kIndexVarint);
+  EXPECT_EQ(encoded.size(), kIndexHeaderSize + 1 + 1 + 2 + 4 + 3);
+  EXPECT_EQ(Decode(encoded, universe), indices);
+}
+
+TEST(IndexCodingTest, DenseIndicesUseBitmap) {
+  // every other index of 1000: 500 varint bytes against a 125 byte bitmap
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 1; i < 1000; i += 2) {
+    indices.push_back(i);
+  }
+  auto encoded = Encode(indices, 1000);
+  EXPECT_EQ(encoded[0], kIndexBitmap);
+  EXPECT_EQ(encoded.size(), kIndexHeaderSize + 125);
+  EXPECT_EQ(Decode(encoded, 1000), indices);
+}
+
+TEST(IndexCodingTest, SwitchesAtTheShorterPayload) {
+  // n indices spaced by one cost n varint bytes against 16 bitmap bytes
+  size_t universe = 128;
+  for (uint32_t n = 1; n <= 64; ++n) {
+    std::vector<uint32_t> indices;
+    for (uint32_t i = 0; i < n; ++i) {
+      indices.push_back(2 * i);
+    }
+    auto encoded = Encode(indices, universe);
+    EXPECT_EQ(encoded[0], n > 16 ? kIndexBitmap : kIndexVarint) << n;
+    EXPECT_EQ(encoded.size(), kIndexHeaderSize + std::min<size_t>(n, 16)) << n;
+    EXPECT_EQ(Decode(encoded, universe), indices) << n;
+  }
+}
+
+TEST(IndexCodingTest, EmptyAndFull) {
+  auto empty = Encode({}, 100);
+  EXPECT_EQ(empty.size(), kIndexHeaderSize);
+  EXPECT_TRUE(Decode(empty, 100).empty());
+  EXPECT_TRUE(Decode(Encode({}, 0), 0).empty());
+
+  // a universe that is not a multiple of 8 or 64
+  std::vector<uint32_t> all(77);
+  for (uint32_t i = 0; i < all.size(); ++i) {
+    all[i] = i;
+  }
+  auto full = Encode(all, all.size());
+  EXPECT_EQ(full[0], kIndexBitmap);
+  EXPECT_EQ(Decode(full, all.size()), all);
+}
+
+TEST(IndexCodingTest, RejectsBadInput) {
+  EXPECT_THROW(Encode({3, 3}, 10), yacl::Exception);
+  EXPECT_THROW(Encode({5, 2}, 10), yacl::Exception);
+  EXPECT_THROW(Encode({10}, 10), yacl::Exception);
+}
+
+TEST(IndexCodingTest, RejectsCountsAboveTheUniverse) {
+  // the count is checked before anything is sized by it
+  auto huge = Header(kIndexBitmap, 0xffffffff);
+  huge.resize(kIndexHeaderSize + 2);
+  EXPECT_THROW(DecodedIndexCount(huge, 16), yacl::Exception);
+  EXPECT_THROW(Decode(huge, 16), yacl::Exception);
+
+  auto varint = Header(kIndexVarint, 11);
+  varint.resize(kIndexHeaderSize + 11);
+  EXPECT_THROW(DecodedIndexCount(varint, 10), yacl::Exception);
+  EXPECT_EQ(DecodedIndexCount(varint, 11), 11);
+}
+
+TEST(IndexCodingTest, RejectsCountsThePayloadCannotHold) {
+  auto varint = Header(kIndexVarint, 3);
+  varint.push_back(0);
+  varint.push_back(0);
+  EXPECT_THROW(DecodedIndexCount(varint, 100), yacl::Exception);
+}
+
+TEST(IndexCodingTest, RejectsMalformedMessages) {
+  size_t universe = 1000;
+  auto sparse = Encode({1, 500, 900}, universe);
+  ASSERT_EQ(sparse[0], kIndexVarint);
+
+  std::vector<uint8_t> no_header(sparse.begin(),
+                                 sparse.begin() + kIndexHeaderSize - 1);
+  EXPECT_THROW(DecodedIndexCount(no_header, universe), yacl::Exception);
+
+  // cut inside the last varint
+  std::vector<uint8_t> truncated(sparse.begin(), sparse.end() - 1);
+  EXPECT_THROW(Decode(truncated, universe), yacl::Exception);
+
+  auto trailing = sparse;
+  trailing.push_back(0);
+  EXPECT_THROW(Decode(trailing, universe), yacl::Exception);
+
+  // 900 is past a smaller universe
+  EXPECT_THROW(Decode(sparse, 900), yacl::Exception);
+
+  // a varint that never ends
+  auto unterminated = Header(kIndexVarint, 1);
+  unterminated.insert(unterminated.end(),
+                      {0xff, 0xff, 0xff, 0xff, 0xff, 0x01});
+  EXPECT_THROW(Decode(unterminated, universe), yacl::Exception);
+
+  auto unknown = sparse;
+  unknown[0] = 2;
+  EXPECT_THROW(Decode(unknown, universe), yacl::Exception);
+
+  std::vector<uint32_t> out(2);
+  EXPECT_THROW(DecodeIndices(sparse, universe, absl::MakeSpan(out)),
+               yacl::Exception);
+}
+
+TEST(IndexCodingTest, RejectsMalformedBitmaps) {
+  std::vector<uint32_t> indices;
+  for (uint32_t i = 0; i < 20; i += 2) {
+    indices.push_back(i);
+  }
+  auto dense = Encode(indices, 20);
+  ASSERT_EQ(dense[0], kIndexBitmap);
+  ASSERT_EQ(dense.size(), kIndexHeaderSize + 3);
+
+  auto short_bitmap = dense;
+  short_bitmap.pop_back();
+  EXPECT_THROW(Decode(short_bitmap, 20), yacl::Exception);
+  auto long_bitmap = dense;
+  long_bitmap.push_back(0);
+  EXPECT_THROW(Decode(long_bitmap, 20), yacl::Exception);
+
+  // index 16 moved past the universe, to 23, keeping the count
+  auto past_universe = dense;
+  past_universe.back() = 0x84;
+  EXPECT_THROW(Decode(past_universe, 20), yacl::Exception);
+
+  // more and fewer bits set than the header counts
+  auto extra_bit = dense;
+  extra_bit[kIndexHeaderSize] |= 0x02;
+  EXPECT_THROW(Decode(extra_bit, 20), yacl::Exception);
+  auto missing_bit = dense;
+  missing_bit[kIndexHeaderSize] &= 0xfe;
+  EXPECT_THROW(Decode(missing_bit, 20), yacl::Exception);
+}
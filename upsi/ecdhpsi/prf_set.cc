@@ -0,0 +1,33 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/ecdhpsi/prf_set.h"
+
+#include "yacl/utils/parallel.h"
+
+std::vector<uint32_t> PrfSet::Probe(absl::Span<const Prf> queries) const {
+  std::vector<uint8_t> hit(queries.size(), 0);
+  yacl::parallel_for(0, queries.size(), [&](int64_t begin, int64_t end) {
+    for (int64_t i = begin; i < end; ++i) {
+      hit[i] = Contains(queries[i]) ? 1 : 0;
+    }
+  });
+  std::vector<uint32_t> ret;
+  for (size_t i = 0; i < queries.size(); ++i) {
+    if (hit[i] != 0) {
+      ret.push_back(i);
+    }
+  }
+  return ret;
+}
@@ -0,0 +1,44 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "absl/types/span.h"
+
+#include "examples/psi/flat_set.h"
+
+// A serialized PRF value H(x)^k.
+constexpr size_t kPrfSize = 32;
+using Prf = std::array<uint8_t, kPrfSize>;
+
+struct PrfHash {
+  uint64_t operator()(const Prf& key) const {
+    uint64_t h;
+    std::memcpy(&h, key.data(), sizeof(h));
+    return examples::psi::MixHash(h);
+  }
+};
+
+// The sender's PRF values, in an examples::psi::FlatSet.
+class PrfSet : public examples::psi::FlatSet<Prf, PrfHash> {
+ public:
+  // Indices i, in increasing order, such that queries[i] is in the set.
+  // Probes run in parallel.
+  std::vector<uint32_t> Probe(absl::Span<const Prf> queries) const;
+};
@@ -0,0 +1,276 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/ecdhpsi/prf_store.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+
+#include "examples/upsi/ecdhpsi/file_sync.h"
+
+#include "yacl/base/exception.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'U', 'P', 'S', 'I', 'P', 'R', 'F', '1'};
+constexpr size_t kHeaderSize = sizeof(kMagic) + sizeof(uint64_t);
+constexpr size_t kRecordSize = 1 + kPrfSize;
+constexpr char kAddOp = '+';
+constexpr char kEraseOp = '-';
+
+// The log is folded into the base once it holds more than this many
+// records and more than a quarter of the base size.
+constexpr size_t kMinCompactRecords = 1 << 16;
+
+}  // namespace
+
+PrfStore::PrfStore(std::string dir) : dir_(std::move(dir)) {
+  std::filesystem::create_directories(dir_);
+  MapBase();
+  ReplayDelta();
+  std::string path = dir_ + "/delta";
+  bool existed = std::filesystem::exists(path);
+  // Drop a torn record left by a crash, or the next append would be
+  // misaligned.
+  if (existed &&
+      std::filesystem::file_size(path) != delta_records_ * kRecordSize) {
+    std::filesystem::resize_file(path, delta_records_ * kRecordSize);
+  }
+  delta_fd_ = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0600);
+  YACL_ENFORCE(delta_fd_ >= 0, "cannot open {}", path);
+  if (!existed) {
+    SyncDir(dir_);
+  }
+}
+
+PrfStore::~PrfStore() {
+  UnmapBase();
+  if (delta_fd_ >= 0) {
+    ::close(delta_fd_);
+  }
+}
+
+bool PrfStore::HasKey() const {
+  return std::filesystem::exists(dir_ + "/key");
+}
+
+yacl::Buffer PrfStore::LoadKey(std::string_view version) const {
+  std::ifstream file(dir_ + "/key", std::ios::binary);
+  YACL_ENFORCE(file.is_open(), "cannot open {}/key", dir_);
+  std::string content((std::istreambuf_iterator<char>(file)),
+                      std::istreambuf_iterator<char>());
+  YACL_ENFORCE(content.size() > version.size() &&
+                   std::string_view(content).substr(0, version.size()) ==
+                       version &&
+                   content[version.size()] == '\n',
+               "PRF store {} was written with another item encoding", dir_);
+  size_t offset = version.size() + 1;
+  return yacl::Buffer(content.data() + offset, content.size() - offset);
+}
+
+void PrfStore::SaveKey(yacl::ByteContainerView key, std::string_view version) {
+  // owner-only before the key is written, and on disk before the rename
+  std::string tmp = dir_ + "/key.tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  YACL_ENFORCE(fd >= 0, "cannot open {}", tmp);
+  try {
+    YACL_ENFORCE(::fchmod(fd, 0600) == 0, "cannot chmod {}", tmp);
+    std::string content(version);
+    content.push_back('\n');
+    content.append(reinterpret_cast<const char*>(key.data()), key.size());
+    WriteFully(fd, content.data(), content.size(), tmp);
+    SyncFile(fd, tmp);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  std::filesystem::rename(tmp, dir_ + "/key");
+  SyncDir(dir_);
+}
+
+void PrfStore::Add(absl::Span<const Prf> prfs) {
+  Append(kAddOp, prfs);
+}
+
+void PrfStore::Erase(absl::Span<const Prf> prfs) {
+  Append(kEraseOp, prfs);
+}
+
+bool PrfStore::Contains(std::string_view prf) const {
+  if (!added_.empty() && added_.count(std::string(prf)) != 0) {
+    return true;
+  }
+  return InBase(prf) &&
+         (removed_.empty() || removed_.count(std::string(prf)) == 0);
+}
+
+size_t PrfStore::size() const {
+  return base_count_ - removed_.size() + added_.size();
+}
+
+void PrfStore::Compact() {
+  std::string tmp = dir_ + "/base.tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  YACL_ENFORCE(fd >= 0, "cannot open {}", tmp);
+  try {
+    std::vector<char> buffer(kHeaderSize);
+    uint64_t count = size();
+    std::memcpy(buffer.data(), kMagic, sizeof(kMagic));
+    std::memcpy(buffer.data() + sizeof(kMagic), &count, sizeof(count));
+    ForEach([&](std::string_view prf) {
+      buffer.insert(buffer.end(), prf.begin(), prf.end());
+      if (buffer.size() >= (1 << 20)) {
+        WriteFully(fd, buffer.data(), buffer.size(), tmp);
+        buffer.clear();
+      }
+    });
+    WriteFully(fd, buffer.data(), buffer.size(), tmp);
+    // The new base must be on disk before it replaces the old one, and the
+    // rename before the log it absorbed is cleared.
+    SyncFile(fd, tmp);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  UnmapBase();
+  std::filesystem::rename(tmp, dir_ + "/base");
+  SyncDir(dir_);
+  added_.clear();
+  removed_.clear();
+  MapBase();
+
+  YACL_ENFORCE(::ftruncate(delta_fd_, 0) == 0, "cannot truncate {}/delta",
+               dir_);
+  SyncFile(delta_fd_, dir_ + "/delta");
+  delta_records_ = 0;
+}
+
+bool PrfStore::InBase(std::string_view prf) const {
+  uint64_t lo = 0;
+  uint64_t hi = base_count_;
+  while (lo < hi) {
+    uint64_t mid = lo + (hi - lo) / 2;
+    int cmp = std::memcmp(base_data_ + mid * kPrfSize, prf.data(), kPrfSize);
+    if (cmp == 0) {
+      return true;
+    }
+    if (cmp < 0) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  return false;
+}
+
+void PrfStore::MapBase() {
+  std::string path = dir_ + "/base";
+  int fd = ::open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    return;  // empty store
+  }
+  struct stat st;
+  YACL_ENFORCE(::fstat(fd, &st) == 0, "cannot stat {}", path);
+  size_t file_size = st.st_size;
+  YACL_ENFORCE(file_size >= kHeaderSize, "{} is truncated", path);
+  void* map = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd);
+  YACL_ENFORCE(map != MAP_FAILED, "cannot map {}", path);
+
+  const char* data = static_cast<const char*>(map);
+  uint64_t count;
+  std::memcpy(&count, data + sizeof(kMagic), sizeof(count));
+  // divide rather than multiply: count is read from disk and count *
+  // kPrfSize can wrap
+  if (std::memcmp(data, kMagic, sizeof(kMagic)) != 0 ||
+      (file_size - kHeaderSize) % kPrfSize != 0 ||
+      count != (file_size - kHeaderSize) / kPrfSize) {
+    ::munmap(map, file_size);
+    YACL_THROW("{} is not a PRF store base file", path);
+  }
+  base_map_ = map;
+  base_map_size_ = file_size;
+  base_data_ = data + kHeaderSize;
+  base_count_ = count;
+}
+
+void PrfStore::UnmapBase() {
+  if (base_map_ != nullptr) {
+    ::munmap(base_map_, base_map_size_);
+  }
+  base_map_ = nullptr;
+  base_map_size_ = 0;
+  base_data_ = nullptr;
+  base_count_ = 0;
+}
+
+void PrfStore::ReplayDelta() {
+  std::ifstream file(dir_ + "/delta", std::ios::binary);
+  if (!file.is_open()) {
+    return;
+  }
+  char record[kRecordSize];
+  while (file.read(record, kRecordSize)) {
+    YACL_ENFORCE(record[0] == kAddOp || record[0] == kEraseOp,
+                 "{}/delta is corrupted", dir_);
+    Apply(record[0], std::string_view(record + 1, kPrfSize));
+    ++delta_records_;
+  }
+}
+
+void PrfStore::Apply(char op, std::string_view prf) {
+  std::string key(prf);
+  if (op == kAddOp) {
+    removed_.erase(key);
+    if (!InBase(prf)) {
+      added_.insert(std::move(key));
+    }
+  } else {
+    added_.erase(key);
+    if (InBase(prf)) {
+      removed_.insert(std::move(key));
+    }
+  }
+}
+
+void PrfStore::Append(char op, absl::Span<const Prf> prfs) {
+  std::vector<char> records(prfs.size() * kRecordSize);
+  for (size_t i = 0; i < prfs.size(); ++i) {
+    records[i * kRecordSize] = op;
+    std::memcpy(records.data() + i * kRecordSize + 1, prfs[i].data(),
+                kPrfSize);
+  }
+  WriteFully(delta_fd_, records.data(), records.size(), dir_ + "/delta");
+  SyncFile(delta_fd_, dir_ + "/delta");
+  for (const auto& prf : prfs) {
+    Apply(op, std::string_view(reinterpret_cast<const char*>(prf.data()),
+                               kPrfSize));
+  }
+  delta_records_ += prfs.size();
+
+  if (delta_records_ > kMinCompactRecords &&
+      delta_records_ > base_count_ / 4) {
+    Compact();
+  }
+}
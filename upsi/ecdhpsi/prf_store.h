@@ -0,0 +1,119 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "absl/types/span.h"
+
+#include "examples/upsi/ecdhpsi/prf_set.h"
+
+#include "yacl/base/buffer.h"
+#include "yacl/base/byte_container_view.h"
+
+// Persistent set of fixed-width PRF values for EcdhSender.
+//
+// A store is a directory holding three files:
+//   key    - the version of the item encoding followed by the secret key
+//   base   - a 16-byte header (magic, count) and `count` sorted PRFs of
+//            kPrfSize bytes each; it is mapped read-only
+//   delta  - an append-only log of (op, PRF) records written by Add/Erase
+//
+// The set is (base + added) - removed, where added and removed are rebuilt
+// from the delta log on open. Compact() merges them into a new base, which
+// replaces the old one atomically, and truncates the log. Replaying a log
+// over a base that already contains it yields the same set, so a crash
+// between the two steps is harmless. A torn record at the end of the log is
+// cut off on open, so later records stay aligned. Every Add/Erase and every
+// compaction is flushed to disk before it returns.
+class PrfStore {
+ public:
+  // Opens the store in dir, creating the directory if needed.
+  explicit PrfStore(std::string dir);
+  ~PrfStore();
+
+  PrfStore(const PrfStore&) = delete;
+  PrfStore& operator=(const PrfStore&) = delete;
+
+  bool HasKey() const;
+  // Returns the stored key. Throws if it was saved under another version.
+  yacl::Buffer LoadKey(std::string_view version) const;
+  void SaveKey(yacl::ByteContainerView key, std::string_view version);
+
+  // Logs and applies a batch of insertions or deletions. Compacts once the
+  // log outgrows the base.
+  void Add(absl::Span<const Prf> prfs);
+  void Erase(absl::Span<const Prf> prfs);
+
+  bool Contains(std::string_view prf) const;
+  size_t size() const;
+
+  // Calls fn(std::string_view) on every PRF in increasing order.
+  template <typename F>
+  void ForEach(F&& fn) const {
+    std::vector<std::string_view> added(added_.begin(), added_.end());
+    std::sort(added.begin(), added.end());
+    auto a = added.begin();
+    for (uint64_t i = 0; i < base_count_; ++i) {
+      std::string_view b = BaseAt(i);
+      for (; a != added.end() && *a < b; ++a) {
+        fn(*a);
+      }
+      if (removed_.empty() || removed_.count(std::string(b)) == 0) {
+        fn(b);
+      }
+    }
+    for (; a != added.end(); ++a) {
+      fn(*a);
+    }
+  }
+
+  // Rewrites the base with the current set and clears the delta log.
+  void Compact();
+
+  // Number of records in the delta log.
+  size_t DeltaSize() const { return delta_records_; }
+
+ private:
+  std::string_view BaseAt(uint64_t i) const {
+    return std::string_view(base_data_ + i * kPrfSize, kPrfSize);
+  }
+  bool InBase(std::string_view prf) const;
+
+  void MapBase();
+  void UnmapBase();
+  void ReplayDelta();
+  void Apply(char op, std::string_view prf);
+  void Append(char op, absl::Span<const Prf> prfs);
+
+  std::string dir_;
+  int delta_fd_ = -1;
+  size_t delta_records_ = 0;
+
+  // read-only mapping of the base file
+  void* base_map_ = nullptr;
+  size_t base_map_size_ = 0;
+  const char* base_data_ = nullptr;
+  uint64_t base_count_ = 0;
+
+  // added_ is disjoint from the base, removed_ is a subset of it
+  std::unordered_set<std::string> added_;
+  std::unordered_set<std::string> removed_;
+};
@@ -0,0 +1,120 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/ecdhpsi/prf_store.h"
+
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+
+Prf MakePrf(uint32_t i) {
+  Prf prf{};
+  std::memcpy(prf.data(), &i, sizeof(i));
+  prf[kPrfSize - 1] = 0x5a;
+  return prf;
+}
+
+std::vector<Prf> MakePrfs(uint32_t begin, uint32_t end) {
+  std::vector<Prf> prfs;
+  for (uint32_t i = begin; i < end; ++i) {
+    prfs.push_back(MakePrf(i));
+  }
+  return prfs;
+}
+
+bool Contains(const PrfStore& store, const Prf& prf) {
+  return store.Contains(
+      std::string_view(reinterpret_cast<const char*>(prf.data()), kPrfSize));
+}
+
+}  // namespace
+
+class PrfStoreTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() / "prf_store_test";
+    std::filesystem::remove_all(dir_);
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  std::string dir_;
+};
+
+TEST_F(PrfStoreTest, ReopenAfterCompactReplaysLog) {
+  {
+    PrfStore store(dir_);
+    store.Add(MakePrfs(0, 100));
+    store.Compact();
+    store.Erase(MakePrfs(0, 10));
+    store.Add(MakePrfs(100, 120));
+  }
+  PrfStore store(dir_);
+  EXPECT_EQ(store.size(), 110U);
+  EXPECT_EQ(store.DeltaSize(), 30U);
+  EXPECT_FALSE(Contains(store, MakePrf(5)));
+  EXPECT_TRUE(Contains(store, MakePrf(50)));
+  EXPECT_TRUE(Contains(store, MakePrf(110)));
+}
+
+TEST_F(PrfStoreTest, TornRecordIsDroppedOnOpen) {
+  {
+    PrfStore store(dir_);
+    store.Add(MakePrfs(0, 10));
+  }
+  // A crash in the middle of an append leaves part of a record behind.
+  {
+    std::ofstream delta(dir_ + "/delta", std::ios::binary | std::ios::app);
+    Prf torn = MakePrf(1000);
+    delta.put('+');
+    delta.write(reinterpret_cast<const char*>(torn.data()), kPrfSize / 2);
+  }
+  {
+    PrfStore store(dir_);
+    EXPECT_EQ(store.size(), 10U);
+    EXPECT_FALSE(Contains(store, MakePrf(1000)));
+    store.Add(MakePrfs(10, 20));
+    store.Erase(MakePrfs(0, 5));
+  }
+  PrfStore store(dir_);
+  EXPECT_EQ(store.DeltaSize(), 25U);
+  EXPECT_EQ(store.size(), 15U);
+  for (uint32_t i = 0; i < 20; ++i) {
+    EXPECT_EQ(Contains(store, MakePrf(i)), i >= 5) << i;
+  }
+  EXPECT_FALSE(Contains(store, MakePrf(1000)));
+}
+
+TEST_F(PrfStoreTest, RejectsBaseCountThatWrapsTheFileSize) {
+  {
+    PrfStore store(dir_);
+    store.Add(MakePrfs(0, 100));
+    store.Compact();
+  }
+  // 100 + 2^59 entries of 32 bytes wrap to the real file size
+  ASSERT_EQ(kPrfSize, 32U);
+  {
+    std::fstream base(dir_ + "/base",
+                      std::ios::binary | std::ios::in | std::ios::out);
+    uint64_t count = 100 + (uint64_t{1} << 59);
+    base.seekp(8);
+    base.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+  EXPECT_THROW(PrfStore store(dir_), yacl::Exception);
+}
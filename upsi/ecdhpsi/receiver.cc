@@ -18,6 +18,8 @@
 #include <memory>
 #include <vector>
 
+#include "examples/psi/point_batch.h"
+#include "examples/upsi/ecdhpsi/index_coding.h"
 #include "examples/upsi/ecdhpsi/sender.h"
 
 #include "yacl/base/int128.h"
@@ -26,33 +28,6 @@
 #include "yacl/link/link.h"
 #include "yacl/utils/parallel.h"
 
-std::vector<uint128_t> GetIntersection(std::vector<uint32_t> z,
-                                       std::vector<uint128_t> y,
-                                       uint32_t z_size) {
-  std::vector<uint128_t> intersection(z_size);
-  yacl::parallel_for(0, z_size, [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      intersection[idx] = y[z[idx]];
-    }
-  });
-  return intersection;
-}
-
-std::vector<uint32_t> ConvertToUint32Vector(const std::vector<uint8_t>& input,
-                                            uint32_t z_size) {
-  std::vector<uint32_t> z(z_size);
-  yacl::parallel_for(0, z_size, [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      auto index = idx * 4;
-      z[idx] = static_cast<uint32_t>(input[index]) |
-               (static_cast<uint32_t>(input[index + 1]) << 8) |
-               (static_cast<uint32_t>(input[index + 2]) << 16) |
-               (static_cast<uint32_t>(input[index + 3]) << 24);
-    }
-  });
-  return z;
-}
-
 void EcdhReceiver::MaskStrings(absl::Span<std::string> in,
                                absl::Span<yc::EcPoint> out) {
   YACL_ENFORCE(in.size() == out.size());
@@ -69,8 +44,7 @@ void EcdhReceiver::MaskInputs(absl::Span<uint128_t> in,
   YACL_ENFORCE(in.size() == out.size());
   yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
     for (size_t idx = begin; idx < end; ++idx) {
-      out[idx] = ec_->HashToCurve(yc::HashToCurveStrategy::Autonomous,
-                                  uint128_to_string(in[idx]));
+      out[idx] = HashItemToCurve(*ec_, in[idx]);
       ec_->MulInplace(&out[idx], sk_);
     }
   });
@@ -108,23 +82,22 @@ void EcdhReceiver::MaskEcPointsD(absl::Span<yc::EcPoint> in,
 
 void EcdhReceiver::PointstoBuffer(absl::Span<yc::EcPoint> in,
                                   absl::Span<std::uint8_t> buffer) {
-  yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      ec_->SerializePoint(in[idx], buffer.data() + offset, 32);
-    }
-  });
+  examples::psi::SerializePoints(*ec_, in, 32,
+                                 buffer.subspan(0, in.size() * 32));
 }
 
 void EcdhReceiver::BuffertoPoints(absl::Span<yc::EcPoint> in,
                                   absl::Span<std::uint8_t> buffer) {
-  yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      in[idx] =
-          ec_->DeserializePoint(absl::MakeSpan(buffer.data() + offset, 32));
-    }
-  });
+  examples::psi::DeserializePoints(*ec_, buffer.subspan(0, in.size() * 32), 32,
+                                   in);
+  examples::psi::CheckPointsInGroup(*ec_, in);
+}
+
+yacl::Buffer EcdhReceiver::GetKey() const { return sk_.Serialize(); }
+
+void EcdhReceiver::SetKey(yacl::ByteContainerView key) {
+  sk_.Deserialize(key);
+  skinv_ = sk_.InvertMod(ec_->GetOrder());
 }
 
 std::vector<uint128_t> EcdhReceiver::EcdhPsiRecv(
@@ -158,14 +131,10 @@ std::vector<uint128_t> EcdhReceiver::EcdhPsiRecv(
       yacl::ByteContainerView(ybuffer.data(), total_length_y * sizeof(uint8_t)),
       "Send H(id)^a");
 
-  yacl::Buffer size_data = ctx->Recv(ctx->PrevRank(), "intersection size");
-
-  uint32_t z_size = *reinterpret_cast<uint32_t*>(size_data.data());
   auto index_data = ctx->Recv(ctx->PrevRank(), "intersection index");
-  std::vector<uint8_t> index_buffer(z_size * 4);
-  std::memcpy(index_buffer.data(), index_data.data(), index_data.size());
-  std::vector<uint32_t> z = ConvertToUint32Vector(index_buffer, z_size);
-  auto psi_result = GetIntersection(z, y, z_size);
-
+  yacl::ByteContainerView indices(index_data.data(), index_data.size());
+  std::vector<uint128_t> psi_result(DecodedIndexCount(indices, y.size()));
+  ForEachIndex(indices, y.size(),
+               [&](size_t i, uint32_t index) { psi_result[i] = y[index]; });
   return psi_result;
 }
\ No newline at end of file
@@ -50,6 +50,11 @@ class EcdhReceiver {
       const std::shared_ptr<yacl::link::Context>& ctx,
       std::vector<uint128_t>& y);
 
+  // The secret key, as saved in a uPSI snapshot. SetKey also recomputes its
+  // inverse.
+  yacl::Buffer GetKey() const;
+  void SetKey(yacl::ByteContainerView key);
+
  private:
   yc::MPInt sk_;  // secret key
   yc::MPInt skinv_;
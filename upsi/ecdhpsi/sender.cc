@@ -20,33 +20,27 @@
 #include <string>
 #include <vector>
 
+#include "examples/psi/point_batch.h"
+#include "examples/upsi/ecdhpsi/index_coding.h"
+
 #include "yacl/crypto/ecc/ec_point.h"
 #include "yacl/crypto/ecc/ecc_spi.h"
 
-inline std::vector<uint32_t> GetIntersectionIdx(
-    const std::set<std::string>& x, const std::vector<std::string>& y) {
-  // std::set<std::string> set(x.begin(), x.end());
-  std::vector<uint32_t> ret;
-  for (uint32_t i = 0; i < y.size(); ++i) {
-    if (x.count(y[i]) != 0) {
-      ret.push_back(i);
-    }
+EcdhSender::EcdhSender(const std::string& store_dir) {
+  ec_ = yc::EcGroupFactory::Instance().Create(/* curve name */ "FourQ");
+  store_ = std::make_unique<PrfStore>(store_dir);
+  if (store_->HasKey()) {
+    sk_.Deserialize(store_->LoadKey(kItemHashDst));
+  } else {
+    yc::MPInt::RandomLtN(ec_->GetOrder(), &sk_);
+    store_->SaveKey(sk_.Serialize(), kItemHashDst);
   }
-  return ret;
-}
-
-std::vector<uint8_t> ConvertToUint8Vector(const std::vector<uint32_t>& input) {
-  std::vector<uint8_t> output(input.size() * 4);
-  yacl::parallel_for(0, input.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      auto index = idx * 4;
-      output[index] = static_cast<uint8_t>(input[idx] & 0xFF);
-      output[index + 1] = static_cast<uint8_t>((input[idx] >> 8) & 0xFF);
-      output[index + 2] = static_cast<uint8_t>((input[idx] >> 16) & 0xFF);
-      output[index + 3] = static_cast<uint8_t>((input[idx] >> 24) & 0xFF);
-    }
+  std::vector<Prf> prfs;
+  prfs.reserve(store_->size());
+  store_->ForEach([&](std::string_view prf) {
+    std::memcpy(prfs.emplace_back().data(), prf.data(), kPrfSize);
   });
-  return output;
+  prfs_.Insert(prfs);
 }
 
 void EcdhSender::MaskStrings(absl::Span<std::string> in,
@@ -65,41 +59,38 @@ void EcdhSender::MaskInputs(absl::Span<uint128_t> in,
   YACL_ENFORCE(in.size() == out.size());
   yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
     for (size_t idx = begin; idx < end; ++idx) {
-      out[idx] = ec_->HashToCurve(yc::HashToCurveStrategy::Autonomous,
-                                  uint128_to_string(in[idx]));
+      out[idx] = HashItemToCurve(*ec_, in[idx]);
       ec_->MulInplace(&out[idx], sk_);
     }
   });
 }
 
-void EcdhSender::UpdatePRFs(absl::Span<uint128_t> in) {
-  std::vector<std::string> out(in.size());
+std::vector<Prf> EcdhSender::ComputePRFs(absl::Span<uint128_t> in) {
+  std::vector<Prf> out(in.size());
   yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
     for (size_t idx = begin; idx < end; ++idx) {
-      auto point = ec_->HashToCurve(yc::HashToCurveStrategy::Autonomous,
-                                    uint128_to_string(in[idx]));
+      auto point = HashItemToCurve(*ec_, in[idx]);
       ec_->MulInplace(&point, sk_);
-      out[idx] = ec_->SerializePoint(point);
+      ec_->SerializePoint(point, out[idx].data(), kPrfSize);
     }
   });
-  std::sort(out.begin(), out.end());
-  prfs_.insert(out.begin(), out.end());
+  return out;
 }
 
-void EcdhSender::DeletePRFs(absl::Span<uint128_t> in) {
-  std::vector<std::string> out(in.size());
-  yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      auto point = ec_->HashToCurve(yc::HashToCurveStrategy::Autonomous,
-                                    uint128_to_string(in[idx]));
-      ec_->MulInplace(&point, sk_);
-      out[idx] = ec_->SerializePoint(point);
-    }
-  });
+void EcdhSender::UpdatePRFs(absl::Span<uint128_t> in) {
+  std::vector<Prf> out = ComputePRFs(in);
+  if (store_) {
+    store_->Add(out);
+  }
+  prfs_.Insert(out);
+}
 
-  for (const auto& elem : out) {
-    prfs_.erase(elem);
+void EcdhSender::DeletePRFs(absl::Span<uint128_t> in) {
+  std::vector<Prf> out = ComputePRFs(in);
+  if (store_) {
+    store_->Erase(out);
   }
+  prfs_.Erase(out);
 }
 
 void EcdhSender::MaskEcPoints(absl::Span<yc::EcPoint> in,
@@ -124,34 +115,15 @@ void EcdhSender::MaskEcPointsD(absl::Span<yc::EcPoint> in,
 
 void EcdhSender::PointstoBuffer(absl::Span<yc::EcPoint> in,
                                 absl::Span<std::uint8_t> buffer) {
-  yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      ec_->SerializePoint(in[idx], buffer.data() + offset, 32);
-    }
-  });
+  examples::psi::SerializePoints(*ec_, in, 32,
+                                 buffer.subspan(0, in.size() * 32));
 }
 
 void EcdhSender::BuffertoPoints(absl::Span<yc::EcPoint> in,
                                 absl::Span<std::uint8_t> buffer) {
-  yacl::parallel_for(0, in.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      in[idx] =
-          ec_->DeserializePoint(absl::MakeSpan(buffer.data() + offset, 32));
-    }
-  });
-}
-
-void EcdhSender::BuffertoStrings(absl::Span<std::uint8_t> in,
-                                 absl::Span<std::string> out) {
-  yacl::parallel_for(0, out.size(), [&](size_t begin, size_t end) {
-    for (size_t idx = begin; idx < end; ++idx) {
-      uint64_t offset = idx * 32;
-      out[idx] =
-          std::string(reinterpret_cast<const char*>(in.data() + offset), 32);
-    }
-  });
+  examples::psi::DeserializePoints(*ec_, buffer.subspan(0, in.size() * 32), 32,
+                                   in);
+  examples::psi::CheckPointsInGroup(*ec_, in);
 }
 
 void EcdhSender::EcdhPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
@@ -175,24 +147,28 @@ void EcdhSender::EcdhPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
                                          maskbuffer.size() * sizeof(uint8_t)),
                  "Send y_mask");
 
-  std::vector<std::string> y_mask_string(size_receiver);
   bufypoints = ctx->Recv(ctx->PrevRank(), "Receive H(id)^a");
   YACL_ENFORCE(bufypoints.size() ==
                int64_t(total_length_receiver * sizeof(uint8_t)));
-  std::memcpy(ybuffer.data(), bufypoints.data(), bufypoints.size());
-  BuffertoStrings(absl::MakeSpan(ybuffer), absl::MakeSpan(y_mask_string));
-  std::vector<uint32_t> z = GetIntersectionIdx(prfs_, y_mask_string);
-  uint32_t z_size = z.size();
-  std::vector<uint8_t> size_data(
-      reinterpret_cast<uint8_t*>(&z_size),
-      reinterpret_cast<uint8_t*>(&z_size) + sizeof(z_size));
-  ctx->SendAsync(ctx->NextRank(), size_data, "intersection size");
-  std::vector<uint8_t> z_data = ConvertToUint8Vector(z);
-
-  ctx->SendAsync(
-      ctx->NextRank(),
-      yacl::ByteContainerView(z_data.data(), z_data.size() * sizeof(uint8_t)),
-      "intersection index");
+  // probe the received PRFs in place
+  static_assert(sizeof(Prf) == kPrfSize);
+  std::vector<uint32_t> z = prfs_.Probe(absl::MakeConstSpan(
+      reinterpret_cast<const Prf*>(bufypoints.data()), size_receiver));
+  ctx->SendAsync(ctx->NextRank(), EncodeIndices(z, size_receiver),
+                 "intersection index");
 }
 
-uint32_t EcdhSender::GetPRFSize() { return prfs_.size(); }
\ No newline at end of file
+uint32_t EcdhSender::GetPRFSize() { return prfs_.size(); }
+
+yacl::Buffer EcdhSender::GetKey() const { return sk_.Serialize(); }
+
+void EcdhSender::SetKey(yacl::ByteContainerView key) {
+  YACL_ENFORCE(store_ == nullptr, "the key of a persistent sender is fixed");
+  sk_.Deserialize(key);
+}
+
+void EcdhSender::SetPRFs(absl::Span<const Prf> prfs) {
+  YACL_ENFORCE(store_ == nullptr, "the PRFs of a persistent sender are fixed");
+  prfs_.Clear();
+  prfs_.Insert(prfs);
+}
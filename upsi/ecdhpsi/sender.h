@@ -14,10 +14,17 @@
 
 #pragma once
 
+#include <array>
 #include <cstdint>
+#include <cstring>
 #include <memory>
+#include <string>
+#include <string_view>
 #include <vector>
 
+#include "examples/upsi/ecdhpsi/prf_set.h"
+#include "examples/upsi/ecdhpsi/prf_store.h"
+
 #include "yacl/base/int128.h"
 #include "yacl/crypto/ecc/ec_point.h"
 #include "yacl/crypto/ecc/ecc_spi.h"
@@ -40,6 +47,21 @@ inline std::string uint128_to_string(uint128_t value) {
 
 namespace yc = yacl::crypto;
 
+// Domain separator prepended to every item before HashToCurve. Items are
+// encoded as their 16 little-endian bytes. PRFs computed under one version
+// never match items hashed under another, so bump the version whenever the
+// encoding changes and recompute stored PRFs.
+inline constexpr std::string_view kItemHashDst = "upsi-ecdh-item-v1";
+
+// H(dst || item), with the input assembled on the stack.
+inline yc::EcPoint HashItemToCurve(const yc::EcGroup& ec, uint128_t item) {
+  std::array<char, kItemHashDst.size() + sizeof(uint128_t)> buffer;
+  std::memcpy(buffer.data(), kItemHashDst.data(), kItemHashDst.size());
+  std::memcpy(buffer.data() + kItemHashDst.size(), &item, sizeof(item));
+  return ec.HashToCurve(yc::HashToCurveStrategy::Autonomous,
+                        std::string_view(buffer.data(), buffer.size()));
+}
+
 class EcdhSender {
  public:
   EcdhSender() {
@@ -50,6 +72,11 @@ class EcdhSender {
     yc::MPInt::RandomLtN(ec_->GetOrder(), &sk_);
   }
 
+  // Opens (or creates) a persistent PRF store in store_dir. The secret key
+  // and the PRFs are restored from it, and every later UpdatePRFs/DeletePRFs
+  // is logged to it.
+  explicit EcdhSender(const std::string& store_dir);
+
   // Mask input strings with secret key, and outputs the EcPoint results
   void MaskStrings(absl::Span<std::string> in, absl::Span<yc::EcPoint> out);
   void MaskInputs(absl::Span<uint128_t> in, absl::Span<yc::EcPoint> out);
@@ -59,17 +86,25 @@ class EcdhSender {
                       absl::Span<std::uint8_t> buffer);
   void BuffertoPoints(absl::Span<yc::EcPoint> in,
                       absl::Span<std::uint8_t> buffer);
-  void BuffertoStrings(absl::Span<std::uint8_t> in,
-                       absl::Span<std::string> out);
+  // PRFs of in, serialized into fixed-width keys
+  std::vector<Prf> ComputePRFs(absl::Span<uint128_t> in);
   void UpdatePRFs(absl::Span<uint128_t> in);
   void DeletePRFs(absl::Span<uint128_t> in);
   void EcdhPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
                    size_t size_receiver);
   uint32_t GetPRFSize();
 
+  // The secret key and PRF set, as saved in a uPSI snapshot. Restoring them
+  // into a sender backed by a PrfStore is not supported.
+  yacl::Buffer GetKey() const;
+  void SetKey(yacl::ByteContainerView key);
+  const PrfSet& GetPRFs() const { return prfs_; }
+  void SetPRFs(absl::Span<const Prf> prfs);
+
  private:
   yc::MPInt sk_;  // secret key
-  std::set<std::string> prfs_;
+  PrfSet prfs_;
+  std::unique_ptr<PrfStore> store_;  // null unless persistent
 
  public:
   std::shared_ptr<yc::EcGroup> ec_;  // ec group
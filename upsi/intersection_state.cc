@@ -0,0 +1,38 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/intersection_state.h"
+
+#include <algorithm>
+
+std::vector<uint128_t> IntersectionState::Filter(
+    absl::Span<const uint128_t> items) const {
+  std::vector<uint128_t> ret;
+  for (const auto& item : items) {
+    if (Contains(item)) {
+      ret.push_back(item);
+    }
+  }
+  std::sort(ret.begin(), ret.end());
+  ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+  return ret;
+}
+
+std::vector<uint128_t> IntersectionState::ExportSorted() const {
+  std::vector<uint128_t> ret;
+  ret.reserve(size());
+  ForEach([&](uint128_t item) { ret.push_back(item); });
+  std::sort(ret.begin(), ret.end());
+  return ret;
+}
@@ -0,0 +1,50 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+
+#include "examples/psi/flat_set.h"
+
+#include "yacl/base/int128.h"
+
+struct ItemHash {
+  uint64_t operator()(uint128_t item) const {
+    return examples::psi::MixHash(static_cast<uint64_t>(item) ^
+                                  static_cast<uint64_t>(item >> 64));
+  }
+};
+
+// The running uPSI intersection, kept by each party across update rounds.
+//
+// An examples::psi::FlatSet of items, like the sender's PrfSet. An update
+// round only touches the items it adds, erases or looks up, so its cost
+// follows the size of the update rather than the size of the intersection.
+class IntersectionState : public examples::psi::FlatSet<uint128_t, ItemHash> {
+ public:
+  IntersectionState() = default;
+  explicit IntersectionState(absl::Span<const uint128_t> items) {
+    Insert(items);
+  }
+
+  // The distinct members of items, in increasing order.
+  std::vector<uint128_t> Filter(absl::Span<const uint128_t> items) const;
+
+  // All members in increasing order.
+  std::vector<uint128_t> ExportSorted() const;
+};
@@ -12,17 +12,29 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <filesystem>
 #include <iostream>
+#include <iterator>
+#include <set>
+#include <string>
 #include <vector>
 
+#include "examples/psi/link_traffic.h"
 #include "examples/upsi/ecdhpsi/ecdh_psi.h"
+#include "examples/upsi/ecdhpsi/index_coding.h"
+#include "examples/upsi/ecdhpsi/prf_set.h"
 #include "examples/upsi/ecdhpsi/receiver.h"
 #include "examples/upsi/ecdhpsi/sender.h"
+#include "examples/upsi/intersection_state.h"
 #include "examples/upsi/psu/psu.h"
 #include "examples/upsi/rr22/okvs/baxos.h"
 #include "examples/upsi/rr22/rr22.h"
+#include "examples/upsi/snapshot.h"
+#include "examples/upsi/update_batch.h"
 #include "examples/upsi/upsi.h"
 
 #include "yacl/base/int128.h"
@@ -155,13 +167,12 @@ void RunUPSI() {
   std::chrono::duration<double> duration_base = end_time_base - start_time_base;
   std::cout << "Base PSI time: " << duration_base.count() << " seconds"
             << std::endl;
-  std::set<uint128_t> intersection_sender(psi_result_sender.begin(),
-                                          psi_result_sender.end());
-  std::set<uint128_t> intersection_receiver(psi_result.begin(),
-                                            psi_result.end());
+  IntersectionState intersection_sender(psi_result_sender);
+  IntersectionState intersection_receiver(psi_result);
   std::cout << "Base PSI intersection size = " << intersection_receiver.size()
             << std::endl;
-  if (intersection_sender == intersection_receiver) {
+  if (intersection_sender.ExportSorted() ==
+      intersection_receiver.ExportSorted()) {
     std::cout << "The base PSI finish." << std::endl;
   } else {
     std::cout << "The base PSI error." << std::endl;
@@ -191,27 +202,25 @@ void RunUPSI() {
   size_t c3 = receiver_stats->sent_bytes.load();
   size_t c4 = receiver_stats->recv_bytes.load();
 
+  // the update runs partly on spawned contexts, counted separately
+  examples::psi::LinkTraffic sender_update;
+  examples::psi::LinkTraffic receiver_update;
   auto start_time1 = std::chrono::high_resolution_clock::now();
-  std::future<std::vector<uint128_t>> upsisender =
-      std::async(std::launch::async, [&] {
-        return UPsiSend(lctxs[0], Y, Yadd, Ysub, yaddreceiver, xaddsender,
-                        intersection_sender);
-      });
+  std::future<void> upsisender = std::async(std::launch::async, [&] {
+    UPsiSend(lctxs[0], Y, Yadd, Ysub, yaddreceiver, xaddsender,
+             intersection_sender, true, &sender_update);
+  });
 
-  std::future<std::vector<uint128_t>> upsireceiver =
-      std::async(std::launch::async, [&] {
-        return UPsiRecv(lctxs[1], X, Xadd, Xsub, xaddreceiver, yaddsender,
-                        intersection_receiver);
-      });
-  auto upsi_result_sender = upsisender.get();
-  auto upsi_result_receiver = upsireceiver.get();
+  std::future<void> upsireceiver = std::async(std::launch::async, [&] {
+    UPsiRecv(lctxs[1], X, Xadd, Xsub, xaddreceiver, yaddsender,
+             intersection_receiver, true, &receiver_update);
+  });
+  upsisender.get();
+  upsireceiver.get();
   auto end_time1 = std::chrono::high_resolution_clock::now();
   std::chrono::duration<double> duration1 = end_time1 - start_time1;
-  std::set<uint128_t> upsi_intersection_sender(upsi_result_sender.begin(),
-                                               upsi_result_sender.end());
-  std::set<uint128_t> upsi_intersection_receiver(upsi_result_receiver.begin(),
-                                                 upsi_result_receiver.end());
-  if (upsi_result_sender == upsi_result_receiver) {
+  if (intersection_sender.ExportSorted() ==
+      intersection_receiver.ExportSorted()) {
     std::cout << "The uPSI finish." << std::endl;
   } else {
     std::cout << "The uPSI error." << std::endl;
@@ -219,10 +228,12 @@ void RunUPSI() {
   std::cout << "UPSI time: " << duration1.count() << " seconds" << std::endl;
   auto sender_stats1 = lctxs[0]->GetStats();
   auto receiver_stats1 = lctxs[1]->GetStats();
-  size_t c5 = sender_stats1->sent_bytes.load() - c1;
-  size_t c6 = sender_stats1->recv_bytes.load() - c2;
-  size_t c7 = receiver_stats1->sent_bytes.load() - c3;
-  size_t c8 = receiver_stats1->recv_bytes.load() - c4;
+  size_t c5 = sender_stats1->sent_bytes.load() - c1 + sender_update.sent_bytes;
+  size_t c6 = sender_stats1->recv_bytes.load() - c2 + sender_update.recv_bytes;
+  size_t c7 =
+      receiver_stats1->sent_bytes.load() - c3 + receiver_update.sent_bytes;
+  size_t c8 =
+      receiver_stats1->recv_bytes.load() - c4 + receiver_update.recv_bytes;
   std::cout << "UPSI Sender sent bytes: " << bytesToMB(c5) << " MB"
             << std::endl;
   std::cout << "UPSI Sender received bytes: " << bytesToMB(c6) << " MB"
@@ -235,6 +246,246 @@ void RunUPSI() {
             << " MB" << std::endl;
 }
 
+// Latency of one update round with the sub-protocols run one after another
+// against run concurrently, for |X^+| = |Y^+| = |X^-| = |Y^-| = 2^4..2^12
+// over |X| = |Y| = 2^16.
+void RunConcurrentUpdateBench() {
+  const uint64_t num = 1 << 16;
+  std::vector<uint128_t> X = CreateRangeItems(1 << 12, num);
+  std::vector<uint128_t> Y = CreateRangeItems(num / 2, num);
+  std::set<uint128_t> x_set(X.begin(), X.end());
+  std::vector<uint128_t> intersection;
+  for (const auto& elem : Y) {
+    if (x_set.count(elem) != 0) {
+      intersection.push_back(elem);
+    }
+  }
+  std::cout << "log2(update), sequential (s), concurrent (s), "
+               "sequential/concurrent comm (MB)"
+            << std::endl;
+  for (size_t logm = 4; logm <= 12; logm += 2) {
+    const uint64_t m = uint64_t{1} << logm;
+    std::vector<uint128_t> Xadd = CreateRangeItems(0, m);
+    std::vector<uint128_t> Yadd = CreateRangeItems(0, m);
+    std::vector<uint128_t> Xsub = CreateRangeItems(num - m, m);
+    std::vector<uint128_t> Ysub = CreateRangeItems(num - m, m);
+    double seconds[2];
+    double comm[2];
+    std::vector<uint128_t> results[2];
+    for (int concurrent = 0; concurrent < 2; ++concurrent) {
+      EcdhReceiver yaddreceiver;
+      EcdhSender yaddsender;
+      yaddsender.UpdatePRFs(absl::MakeSpan(X));
+      EcdhReceiver xaddreceiver;
+      EcdhSender xaddsender;
+      xaddsender.UpdatePRFs(absl::MakeSpan(Y));
+      IntersectionState intersection_sender(intersection);
+      IntersectionState intersection_receiver(intersection);
+      auto lctxs = yacl::link::test::SetupWorld(2);
+
+      examples::psi::LinkTraffic sender_traffic;
+
+      auto start_time = std::chrono::high_resolution_clock::now();
+      std::future<void> upsisender = std::async(std::launch::async, [&] {
+        UPsiSend(lctxs[0], Y, Yadd, Ysub, yaddreceiver, xaddsender,
+                 intersection_sender, concurrent != 0, &sender_traffic);
+      });
+      std::future<void> upsireceiver = std::async(std::launch::async, [&] {
+        UPsiRecv(lctxs[1], X, Xadd, Xsub, xaddreceiver, yaddsender,
+                 intersection_receiver, concurrent != 0);
+      });
+      upsisender.get();
+      upsireceiver.get();
+      auto end_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double> duration = end_time - start_time;
+      seconds[concurrent] = duration.count();
+      results[concurrent] = intersection_receiver.ExportSorted();
+      sender_traffic.Add(*lctxs[0]);
+      comm[concurrent] = static_cast<double>(sender_traffic.sent_bytes +
+                                             sender_traffic.recv_bytes) /
+                         (1024 * 1024);
+    }
+    YACL_ENFORCE(results[0] == results[1]);
+    std::cout << logm << ", " << seconds[0] << ", " << seconds[1] << ", "
+              << comm[0] << "/" << comm[1] << std::endl;
+  }
+}
+
+// Per-update cost at |I| = 2^20 with small deltas. First the local
+// bookkeeping of one round: the old by-value std::set (copy, set_intersection
+// with the deleted items, erase/insert, result vector) against
+// IntersectionState (Filter, Erase, Insert). Then the latency of whole update
+// rounds over 2^20 items with 2^6 changes each.
+void RunIntersectionStateBench() {
+  const uint64_t num = 1 << 20;
+  std::vector<uint128_t> items = CreateRangeItems(0, num);
+  std::cout << "log2(delta), std::set round (s), IntersectionState round (s)"
+            << std::endl;
+  for (size_t logm = 4; logm <= 12; logm += 4) {
+    const uint64_t m = uint64_t{1} << logm;
+    std::vector<uint128_t> sub = CreateRangeItems(num - m, m);
+    std::vector<uint128_t> add = CreateRangeItems(num, m);
+    std::set<uint128_t> old_state(items.begin(), items.end());
+    IntersectionState state(items);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::set<uint128_t> copy = old_state;
+    std::set<uint128_t> subset(sub.begin(), sub.end());
+    std::set<uint128_t> subsetintersection;
+    std::set_intersection(
+        subset.begin(), subset.end(), copy.begin(), copy.end(),
+        std::inserter(subsetintersection, subsetintersection.begin()));
+    for (const auto& elem : subsetintersection) {
+      copy.erase(elem);
+    }
+    for (const auto& elem : add) {
+      copy.insert(elem);
+    }
+    std::vector<uint128_t> old_result(copy.begin(), copy.end());
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<uint128_t> w = state.Filter(sub);
+    state.Erase(w);
+    state.Insert(add);
+    auto t2 = std::chrono::high_resolution_clock::now();
+
+    YACL_ENFORCE(state.ExportSorted() == old_result);
+    std::chrono::duration<double> old_duration = t1 - t0;
+    std::chrono::duration<double> new_duration = t2 - t1;
+    std::cout << logm << ", " << old_duration.count() << ", "
+              << new_duration.count() << std::endl;
+  }
+
+  const uint64_t m = 1 << 6;
+  EcdhReceiver yaddreceiver;
+  EcdhSender yaddsender;
+  yaddsender.UpdatePRFs(absl::MakeSpan(items));
+  EcdhReceiver xaddreceiver;
+  EcdhSender xaddsender;
+  xaddsender.UpdatePRFs(absl::MakeSpan(items));
+  IntersectionState intersection_sender(items);
+  IntersectionState intersection_receiver(items);
+  auto lctxs = yacl::link::test::SetupWorld(2);
+  for (size_t round = 0; round < 4; ++round) {
+    std::vector<uint128_t> Xadd = CreateRangeItems(num + round * m, m);
+    std::vector<uint128_t> Yadd = Xadd;
+    std::vector<uint128_t> Xsub = CreateRangeItems(round * m, m);
+    std::vector<uint128_t> Ysub = Xsub;
+    auto start_time = std::chrono::high_resolution_clock::now();
+    std::future<void> upsisender = std::async(std::launch::async, [&] {
+      UPsiSend(lctxs[0], items, Yadd, Ysub, yaddreceiver, xaddsender,
+               intersection_sender);
+    });
+    std::future<void> upsireceiver = std::async(std::launch::async, [&] {
+      UPsiRecv(lctxs[1], items, Xadd, Xsub, xaddreceiver, yaddsender,
+               intersection_receiver);
+    });
+    upsisender.get();
+    upsireceiver.get();
+    auto end_time = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> duration = end_time - start_time;
+    YACL_ENFORCE(intersection_receiver.size() == num);
+    std::cout << "Update round " << round << " at |I| = 2^20, |delta| = 2^6: "
+              << duration.count() << " seconds" << std::endl;
+  }
+}
+
+// k update epochs run as k separate rounds against the same epochs coalesced
+// by UpdateBatch into one round, over |X| = |Y| = 2^16. Every epoch adds 2^4
+// items and deletes 2^4, half of them added by the previous epoch. Messages
+// are those sent by both parties and MB those the sender sent and received,
+// on ctx and on every context the rounds spawned. The link only counts
+// messages and bytes, so the round counts, k and 1, are not repeated here.
+void RunBatchedUpdateBench() {
+  const uint64_t num = 1 << 16;
+  const uint64_t m = 1 << 4;
+  std::vector<uint128_t> X = CreateRangeItems(0, num);
+  std::vector<uint128_t> Y = CreateRangeItems(num / 2, num);
+  std::vector<uint128_t> base_intersection = CreateRangeItems(num / 2, num / 2);
+  std::cout << "epochs, separate messages/MB/s, coalesced messages/MB/s"
+            << std::endl;
+  for (size_t k : {4, 16, 64}) {
+    std::vector<std::vector<uint128_t>> adds(k);
+    std::vector<std::vector<uint128_t>> subs(k);
+    for (size_t e = 0; e < k; ++e) {
+      adds[e] = CreateRangeItems(2 * num + e * m, m);
+      subs[e] = CreateRangeItems(num / 2 + e * m, e == 0 ? m : m / 2);
+      if (e > 0) {
+        subs[e].insert(subs[e].end(), adds[e - 1].begin(),
+                       adds[e - 1].begin() + m / 2);
+      }
+    }
+
+    std::vector<uint128_t> results[2];
+    size_t messages[2];
+    double comm[2];
+    double seconds[2];
+    for (int coalesced = 0; coalesced < 2; ++coalesced) {
+      EcdhReceiver yaddreceiver;
+      EcdhSender yaddsender;
+      yaddsender.UpdatePRFs(absl::MakeSpan(X));
+      EcdhReceiver xaddreceiver;
+      EcdhSender xaddsender;
+      xaddsender.UpdatePRFs(absl::MakeSpan(Y));
+      IntersectionState intersection_sender(base_intersection);
+      IntersectionState intersection_receiver(base_intersection);
+      auto lctxs = yacl::link::test::SetupWorld(2);
+      examples::psi::LinkTraffic sender_traffic;
+      examples::psi::LinkTraffic receiver_traffic;
+
+      auto start_time = std::chrono::high_resolution_clock::now();
+      if (coalesced != 0) {
+        UpdateBatch batch;
+        for (size_t e = 0; e < k; ++e) {
+          batch.Push(adds[e], subs[e]);
+        }
+        std::future<void> upsisender = std::async(std::launch::async, [&] {
+          UPsiSend(lctxs[0], Y, batch, yaddreceiver, xaddsender,
+                   intersection_sender, true, &sender_traffic);
+        });
+        std::future<void> upsireceiver = std::async(std::launch::async, [&] {
+          UPsiRecv(lctxs[1], X, batch, xaddreceiver, yaddsender,
+                   intersection_receiver, true, &receiver_traffic);
+        });
+        upsisender.get();
+        upsireceiver.get();
+      } else {
+        for (size_t e = 0; e < k; ++e) {
+          std::vector<uint128_t> Yadd = adds[e];
+          std::vector<uint128_t> Ysub = subs[e];
+          std::vector<uint128_t> Xadd = adds[e];
+          std::vector<uint128_t> Xsub = subs[e];
+          std::future<void> upsisender = std::async(std::launch::async, [&] {
+            UPsiSend(lctxs[0], Y, Yadd, Ysub, yaddreceiver, xaddsender,
+                     intersection_sender, true, &sender_traffic);
+          });
+          std::future<void> upsireceiver = std::async(std::launch::async, [&] {
+            UPsiRecv(lctxs[1], X, Xadd, Xsub, xaddreceiver, yaddsender,
+                     intersection_receiver, true, &receiver_traffic);
+          });
+          upsisender.get();
+          upsireceiver.get();
+        }
+      }
+      auto end_time = std::chrono::high_resolution_clock::now();
+      std::chrono::duration<double> duration = end_time - start_time;
+      seconds[coalesced] = duration.count();
+      sender_traffic.Add(*lctxs[0]);
+      receiver_traffic.Add(*lctxs[1]);
+      messages[coalesced] =
+          sender_traffic.sent_actions + receiver_traffic.sent_actions;
+      comm[coalesced] = static_cast<double>(sender_traffic.sent_bytes +
+                                            sender_traffic.recv_bytes) /
+                        (1024 * 1024);
+      results[coalesced] = intersection_receiver.ExportSorted();
+      YACL_ENFORCE(results[coalesced] == intersection_sender.ExportSorted());
+    }
+    YACL_ENFORCE(results[0] == results[1]);
+    std::cout << k << ", " << messages[0] << "/" << comm[0] << "/"
+              << seconds[0] << ", " << messages[1] << "/" << comm[1] << "/"
+              << seconds[1] << std::endl;
+  }
+}
+
 int RunPSU() {
   const int kWorldSize = 2;
   auto contexts = yacl::link::test::SetupWorld(kWorldSize);
@@ -384,7 +635,233 @@ int RunAEcdhPsi() {
   return 0;
 }
 
+// Hash-to-curve from decimal strings (the old encoding) against the 16-byte
+// little-endian encoding, and the resulting UpdatePRFs time.
+void RunHashToCurveBench() {
+  const uint64_t num = 1 << 20;
+  std::vector<uint128_t> items = CreateRangeItems(0, num);
+  EcdhSender sender;
+  std::vector<yc::EcPoint> points(num);
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+  yacl::parallel_for(0, num, [&](size_t begin, size_t end) {
+    for (size_t idx = begin; idx < end; ++idx) {
+      points[idx] =
+          sender.ec_->HashToCurve(yc::HashToCurveStrategy::Autonomous,
+                                  uint128_to_string(items[idx]));
+    }
+  });
+  auto mid_time = std::chrono::high_resolution_clock::now();
+  yacl::parallel_for(0, num, [&](size_t begin, size_t end) {
+    for (size_t idx = begin; idx < end; ++idx) {
+      points[idx] = HashItemToCurve(*sender.ec_, items[idx]);
+    }
+  });
+  auto end_time = std::chrono::high_resolution_clock::now();
+  sender.UpdatePRFs(absl::MakeSpan(items));
+  auto update_time = std::chrono::high_resolution_clock::now();
+
+  std::chrono::duration<double> string_duration = mid_time - start_time;
+  std::chrono::duration<double> binary_duration = end_time - mid_time;
+  std::chrono::duration<double> update_duration = update_time - end_time;
+  std::cout << "HashToCurve of 2^20 items, decimal strings: "
+            << string_duration.count() << " seconds" << std::endl;
+  std::cout << "HashToCurve of 2^20 items, 16-byte encoding: "
+            << binary_duration.count() << " seconds" << std::endl;
+  std::cout << "UpdatePRFs of 2^20 items: " << update_duration.count()
+            << " seconds" << std::endl;
+}
+
+// Snapshot and restore of one party's uPSI state with 2^22 PRFs, a 2^22-item
+// intersection and a 2^22-item base result. Random values stand in for the
+// PRFs, since computing 2^22 real ones is what a restore avoids.
+void RunSnapshotBench() {
+  const uint64_t num = 1 << 22;
+  std::string path = "upsi_snapshot";
+  std::vector<Prf> prfs(num);
+  yacl::crypto::Prg<uint8_t> prng(yacl::crypto::FastRandU128());
+  prng.Fill(absl::MakeSpan(prfs.data()->data(), num * kPrfSize));
+  UPsiPartyState state;
+  state.sender.SetPRFs(prfs);
+  state.base_result = CreateRangeItems(0, num);
+  state.intersection.Insert(state.base_result);
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+  SaveUPsiSnapshot(state, path);
+  auto mid_time = std::chrono::high_resolution_clock::now();
+  UPsiPartyState restored;
+  LoadUPsiSnapshot(path, &restored);
+  auto end_time = std::chrono::high_resolution_clock::now();
+
+  YACL_ENFORCE(restored.sender.GetPRFSize() == num);
+  YACL_ENFORCE(restored.intersection.size() == num);
+  std::chrono::duration<double> save_duration = mid_time - start_time;
+  std::chrono::duration<double> load_duration = end_time - mid_time;
+  std::cout << "Snapshot of 2^22 PRFs + 2^22 + 2^22 items ("
+            << std::filesystem::file_size(path) / (1024 * 1024)
+            << " MB): save " << save_duration.count() << " seconds, restore "
+            << load_duration.count() << " seconds" << std::endl;
+  std::filesystem::remove(path);
+}
+
+// Intersection index message of the ECDH PSI at |Y| = 2^20 for several
+// intersection densities: the old size message plus 4 bytes per index,
+// repacked and gathered through copies, against one EncodeIndices message
+// gathered straight into the result. Times cover encode, send, receive and
+// decode.
+void RunIndexCodingBench() {
+  const uint32_t num = 1 << 20;
+  std::vector<uint128_t> y = CreateRangeItems(0, num);
+  std::cout << "density, old bytes/s, new bytes/s" << std::endl;
+  for (uint32_t stride : {1024, 64, 8, 4, 2, 1}) {
+    std::vector<uint32_t> z;
+    for (uint32_t i = 0; i < num; i += stride) {
+      z.push_back(i);
+    }
+    auto lctxs = yacl::link::test::SetupWorld(2);
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    uint32_t z_size = z.size();
+    lctxs[0]->SendAsync(lctxs[0]->NextRank(),
+                        yacl::ByteContainerView(&z_size, sizeof(z_size)),
+                        "intersection size");
+    std::vector<uint8_t> z_data(z.size() * 4);
+    std::memcpy(z_data.data(), z.data(), z_data.size());
+    lctxs[0]->SendAsync(lctxs[0]->NextRank(), z_data, "intersection index");
+    yacl::Buffer size_data =
+        lctxs[1]->Recv(lctxs[1]->PrevRank(), "intersection size");
+    uint32_t old_size = *reinterpret_cast<uint32_t*>(size_data.data());
+    auto index_data =
+        lctxs[1]->Recv(lctxs[1]->PrevRank(), "intersection index");
+    std::vector<uint8_t> index_buffer(old_size * 4);
+    std::memcpy(index_buffer.data(), index_data.data(), index_data.size());
+    std::vector<uint32_t> old_z(old_size);
+    std::memcpy(old_z.data(), index_buffer.data(), index_buffer.size());
+    std::vector<uint32_t> z_copy = old_z;
+    std::vector<uint128_t> y_copy = y;
+    std::vector<uint128_t> old_result(old_size);
+    for (size_t i = 0; i < old_size; ++i) {
+      old_result[i] = y_copy[z_copy[i]];
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    size_t old_bytes = lctxs[0]->GetStats()->sent_bytes.load();
+
+    lctxs[0]->SendAsync(lctxs[0]->NextRank(), EncodeIndices(z, num),
+                        "intersection index");
+    auto new_data = lctxs[1]->Recv(lctxs[1]->PrevRank(), "intersection index");
+    yacl::ByteContainerView indices(new_data.data(), new_data.size());
+    std::vector<uint128_t> new_result(DecodedIndexCount(indices, num));
+    ForEachIndex(indices, num,
+                 [&](size_t i, uint32_t index) { new_result[i] = y[index]; });
+    auto t2 = std::chrono::high_resolution_clock::now();
+    size_t new_bytes = lctxs[0]->GetStats()->sent_bytes.load() - old_bytes;
+
+    YACL_ENFORCE(old_result == new_result);
+    std::chrono::duration<double> old_duration = t1 - t0;
+    std::chrono::duration<double> new_duration = t2 - t1;
+    std::cout << "1/" << stride << ", " << old_bytes << "/"
+              << old_duration.count() << ", " << new_bytes << "/"
+              << new_duration.count() << std::endl;
+  }
+}
+
+// Time to bring up a sender holding 2^20 PRFs: recomputing every H(x)^k
+// against reopening a persistent store.
+void RunPrfStoreBench() {
+  const uint64_t num = 1 << 20;
+  std::vector<uint128_t> items = CreateRangeItems(0, num);
+  std::string dir = "upsi_prf_store";
+  std::filesystem::remove_all(dir);
+
+  auto start_time = std::chrono::high_resolution_clock::now();
+  {
+    EcdhSender sender(dir);
+    sender.UpdatePRFs(absl::MakeSpan(items));
+  }
+  auto mid_time = std::chrono::high_resolution_clock::now();
+  EcdhSender restarted(dir);
+  auto end_time = std::chrono::high_resolution_clock::now();
+
+  std::chrono::duration<double> compute_duration = mid_time - start_time;
+  std::chrono::duration<double> restart_duration = end_time - mid_time;
+  std::cout << "Compute and store 2^20 PRFs: " << compute_duration.count()
+            << " seconds" << std::endl;
+  std::cout << "Restart from store (" << restarted.GetPRFSize()
+            << " PRFs): " << restart_duration.count() << " seconds"
+            << std::endl;
+  std::filesystem::remove_all(dir);
+}
+
+// Update and lookup cost of the sender's PRF set: std::set<std::string>
+// against PrfSet. Each round inserts n PRFs, probes n queries of which half
+// hit, and erases a quarter of the set.
+void RunPrfSetBench() {
+  std::cout << "log2(n), std::set insert/probe/erase (s), "
+               "PrfSet insert/probe/erase (s)"
+            << std::endl;
+  for (size_t logn = 16; logn <= 24; logn += 2) {
+    size_t n = size_t{1} << logn;
+    std::vector<Prf> keys(n);
+    std::vector<Prf> queries(n);
+    yacl::crypto::Prg<uint8_t> prng(yacl::crypto::FastRandU128());
+    prng.Fill(absl::MakeSpan(keys.data()->data(), n * kPrfSize));
+    prng.Fill(absl::MakeSpan(queries.data()->data(), n * kPrfSize));
+    std::copy(keys.begin(), keys.begin() + n / 2, queries.begin() + n / 4);
+    auto to_string = [](const Prf& prf) {
+      return std::string(reinterpret_cast<const char*>(prf.data()),
+                         prf.size());
+    };
+
+    auto t0 = std::chrono::high_resolution_clock::now();
+    std::set<std::string> set;
+    for (const auto& key : keys) {
+      set.insert(to_string(key));
+    }
+    auto t1 = std::chrono::high_resolution_clock::now();
+    std::vector<uint32_t> z_set;
+    for (uint32_t i = 0; i < n; ++i) {
+      if (set.count(to_string(queries[i])) != 0) {
+        z_set.push_back(i);
+      }
+    }
+    auto t2 = std::chrono::high_resolution_clock::now();
+    for (size_t i = 0; i < n / 4; ++i) {
+      set.erase(to_string(keys[i]));
+    }
+    auto t3 = std::chrono::high_resolution_clock::now();
+
+    PrfSet prfs;
+    prfs.Insert(keys);
+    auto t4 = std::chrono::high_resolution_clock::now();
+    auto z = prfs.Probe(queries);
+    auto t5 = std::chrono::high_resolution_clock::now();
+    prfs.Erase(absl::MakeConstSpan(keys.data(), n / 4));
+    auto t6 = std::chrono::high_resolution_clock::now();
+
+    YACL_ENFORCE(z == z_set);
+    YACL_ENFORCE(prfs.size() == set.size());
+    std::chrono::duration<double> set_insert = t1 - t0;
+    std::chrono::duration<double> set_probe = t2 - t1;
+    std::chrono::duration<double> set_erase = t3 - t2;
+    std::chrono::duration<double> flat_insert = t4 - t3;
+    std::chrono::duration<double> flat_probe = t5 - t4;
+    std::chrono::duration<double> flat_erase = t6 - t5;
+    std::cout << logn << ", " << set_insert.count() << "/"
+              << set_probe.count() << "/" << set_erase.count() << ", "
+              << flat_insert.count() << "/" << flat_probe.count() << "/"
+              << flat_erase.count() << std::endl;
+  }
+}
+
 int main() {
   RunUPSI();
+  RunConcurrentUpdateBench();
+  RunIntersectionStateBench();
+  RunBatchedUpdateBench();
+  RunHashToCurveBench();
+  RunPrfStoreBench();
+  RunSnapshotBench();
+  RunIndexCodingBench();
+  RunPrfSetBench();
   // RunAEcdhPsi();
 }
\ No newline at end of file
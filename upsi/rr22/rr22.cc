@@ -19,6 +19,7 @@
 #include <vector>
 
 #include "examples/upsi/rr22/okvs/galois128.h"
+#include "examples/psi/mask_intersection.h"
 
 #include "yacl/base/int128.h"
 #include "yacl/kernel/algorithms/silent_vole.h"
@@ -40,21 +41,8 @@ std::vector<uint128_t> GetIntersection(std::vector<int32_t> z,
 
 inline std::vector<int32_t> GetIntersectionIdx(
     const std::vector<uint128_t>& x, const std::vector<uint128_t>& y) {
-  std::set<uint128_t> set(x.begin(), x.end());
-  std::vector<int32_t> ret(y.size(), -1);  // 初始化为 -1
-
-  yacl::parallel_for(0, y.size(), [&](size_t start, size_t end) {
-    for (size_t i = start; i < end; ++i) {
-      if (set.count(y[i]) != 0) {
-        ret[i] = i;
-      }
-    }
-  });
-
-  // 清除所有值为 -1 的元素
-  ret.erase(std::remove(ret.begin(), ret.end(), -1), ret.end());
-
-  return ret;
+  auto idx = examples::psi::IntersectMasks(x, y);
+  return std::vector<int32_t>(idx.begin(), idx.end());
 }
 
 std::vector<uint128_t> RR22PsiRecv(
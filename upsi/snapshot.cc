@@ -0,0 +1,177 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/snapshot.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string_view>
+
+#include "examples/upsi/ecdhpsi/file_sync.h"
+
+#include "yacl/base/exception.h"
+
+namespace {
+
+constexpr char kMagic[8] = {'U', 'P', 'S', 'I', 'S', 'N', 'A', 'P'};
+constexpr uint32_t kVersion = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t dst_size;
+  uint32_t receiver_key_size;
+  uint32_t sender_key_size;
+  uint64_t prf_count;
+  uint64_t intersection_count;
+  uint64_t base_count;
+};
+
+size_t FileSize(const Header& header) {
+  return sizeof(Header) + header.dst_size + header.receiver_key_size +
+         header.sender_key_size + header.prf_count * kPrfSize +
+         (header.intersection_count + header.base_count) * sizeof(uint128_t);
+}
+
+// Whether the sections a header read from disk announces fill exactly the
+// file_size - sizeof(Header) bytes after it. Every count is checked against
+// the bytes left before it is multiplied, so no product can wrap around.
+bool FitsFile(const Header& header, size_t file_size) {
+  size_t left = file_size - sizeof(Header);
+  auto take = [&](uint64_t count, size_t width) {
+    if (count > left / width) {
+      return false;
+    }
+    left -= count * width;
+    return true;
+  };
+  return take(header.dst_size, 1) && take(header.receiver_key_size, 1) &&
+         take(header.sender_key_size, 1) && take(header.prf_count, kPrfSize) &&
+         take(header.intersection_count, sizeof(uint128_t)) &&
+         take(header.base_count, sizeof(uint128_t)) && left == 0;
+}
+
+}  // namespace
+
+void SaveUPsiSnapshot(const UPsiPartyState& state, const std::string& path) {
+  yacl::Buffer receiver_key = state.receiver.GetKey();
+  yacl::Buffer sender_key = state.sender.GetKey();
+  Header header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.dst_size = kItemHashDst.size();
+  header.receiver_key_size = receiver_key.size();
+  header.sender_key_size = sender_key.size();
+  header.prf_count = state.sender.GetPRFs().size();
+  header.intersection_count = state.intersection.size();
+  header.base_count = state.base_result.size();
+
+  std::vector<char> buffer(FileSize(header));
+  char* out = buffer.data();
+  auto put = [&](const void* data, size_t size) {
+    if (size != 0) {
+      std::memcpy(out, data, size);
+      out += size;
+    }
+  };
+  put(&header, sizeof(header));
+  put(kItemHashDst.data(), kItemHashDst.size());
+  put(receiver_key.data(), receiver_key.size());
+  put(sender_key.data(), sender_key.size());
+  state.sender.GetPRFs().ForEach(
+      [&](const Prf& prf) { put(prf.data(), kPrfSize); });
+  state.intersection.ForEach(
+      [&](uint128_t item) { put(&item, sizeof(item)); });
+  put(state.base_result.data(), state.base_result.size() * sizeof(uint128_t));
+  YACL_ENFORCE(out == buffer.data() + buffer.size());
+
+  // The snapshot holds both secret keys, so the file is owner-only before
+  // any of it is written; fchmod covers a stale tmp file left with another
+  // mode. It is on disk before it replaces path, and the rename is made
+  // durable too.
+  std::string tmp = path + ".tmp";
+  int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  YACL_ENFORCE(fd >= 0, "cannot open {}: {}", tmp, std::strerror(errno));
+  try {
+    YACL_ENFORCE(::fchmod(fd, 0600) == 0, "cannot chmod {}: {}", tmp,
+                 std::strerror(errno));
+    WriteFully(fd, buffer.data(), buffer.size(), tmp);
+    SyncFile(fd, tmp);
+  } catch (...) {
+    ::close(fd);
+    throw;
+  }
+  ::close(fd);
+  std::filesystem::rename(tmp, path);
+  std::filesystem::path dir = std::filesystem::path(path).parent_path();
+  SyncDir(dir.empty() ? "." : dir.string());
+}
+
+void LoadUPsiSnapshot(const std::string& path, UPsiPartyState* state) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  YACL_ENFORCE(file.is_open(), "cannot open {}", path);
+  size_t file_size = file.tellg();
+  file.seekg(0);
+  YACL_ENFORCE(file_size >= sizeof(Header), "{} is truncated", path);
+  std::vector<char> buffer(file_size);
+  file.read(buffer.data(), file_size);
+  YACL_ENFORCE(file.good(), "cannot read {}", path);
+
+  Header header;
+  std::memcpy(&header, buffer.data(), sizeof(header));
+  YACL_ENFORCE(std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0,
+               "{} is not a uPSI snapshot", path);
+  YACL_ENFORCE(header.version == kVersion,
+               "{} has snapshot version {}, expected {}", path, header.version,
+               kVersion);
+  YACL_ENFORCE(FitsFile(header, file_size),
+               "{} has {} bytes, which does not match its header", path,
+               file_size);
+
+  const char* in = buffer.data() + sizeof(header);
+  YACL_ENFORCE(std::string_view(in, header.dst_size) == kItemHashDst,
+               "{} was written with another item encoding", path);
+  in += header.dst_size;
+  state->receiver.SetKey(
+      yacl::ByteContainerView(in, header.receiver_key_size));
+  in += header.receiver_key_size;
+  state->sender.SetKey(yacl::ByteContainerView(in, header.sender_key_size));
+  in += header.sender_key_size;
+
+  static_assert(alignof(Prf) == 1);
+  state->sender.SetPRFs(absl::MakeConstSpan(reinterpret_cast<const Prf*>(in),
+                                            header.prf_count));
+  in += header.prf_count * kPrfSize;
+
+  // the item arrays are not 16-byte aligned in the buffer
+  auto take_items = [&](uint64_t count) {
+    std::vector<uint128_t> items(count);
+    if (count != 0) {
+      std::memcpy(items.data(), in, count * sizeof(uint128_t));
+      in += count * sizeof(uint128_t);
+    }
+    return items;
+  };
+  std::vector<uint128_t> items = take_items(header.intersection_count);
+  state->intersection.Clear();
+  state->intersection.Insert(items);
+  state->base_result = take_items(header.base_count);
+}
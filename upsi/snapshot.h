@@ -0,0 +1,49 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "examples/upsi/ecdhpsi/receiver.h"
+#include "examples/upsi/ecdhpsi/sender.h"
+#include "examples/upsi/intersection_state.h"
+
+#include "yacl/base/int128.h"
+
+// Everything one uPSI party carries from one round to the next.
+struct UPsiPartyState {
+  // runs the ECDH PSI over this party's additions
+  EcdhReceiver receiver;
+  // holds the PRFs of this party's set under its own key
+  EcdhSender sender;
+  IntersectionState intersection;
+  // output of the base PSI the rounds started from
+  std::vector<uint128_t> base_result;
+};
+
+// Versioned binary snapshot of a UPsiPartyState.
+//
+// The file is a fixed header (magic, format version, section sizes), the
+// item encoding version kItemHashDst, both secret keys, and then the PRFs
+// (kPrfSize bytes each), the intersection and the base result (16 bytes
+// each) as flat arrays. Nothing is sorted or compressed, so a restore is one
+// read followed by a rebuild of the two hash tables. A snapshot is written to
+// an owner-only temporary file, synced, and renamed over path.
+void SaveUPsiSnapshot(const UPsiPartyState& state, const std::string& path);
+
+// Throws if path is not a snapshot of this format version, its size does not
+// match its header, or it was written under another item encoding.
+void LoadUPsiSnapshot(const std::string& path, UPsiPartyState* state);
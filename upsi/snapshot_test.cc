@@ -0,0 +1,185 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/snapshot.h"
+
+#include <sys/stat.h>
+
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "examples/upsi/upsi.h"
+#include "gtest/gtest.h"
+
+#include "yacl/base/exception.h"
+#include "yacl/link/test_util.h"
+
+namespace {
+
+std::vector<uint128_t> CreateRangeItems(size_t begin, size_t size) {
+  std::vector<uint128_t> ret;
+  for (size_t i = 0; i < size; ++i) {
+    ret.push_back(yacl::MakeUint128((begin + i) % 7, begin + i));
+  }
+  return ret;
+}
+
+// One update round with the given changes to X and Y.
+void RunRound(UPsiPartyState& receiver_state, UPsiPartyState& sender_state,
+              std::vector<uint128_t> x, std::vector<uint128_t> y,
+              std::vector<uint128_t> xadd, std::vector<uint128_t> xsub,
+              std::vector<uint128_t> yadd, std::vector<uint128_t> ysub) {
+  auto lctxs = yacl::link::test::SetupWorld(2);
+  auto sender = std::async(std::launch::async, [&] {
+    UPsiSend(lctxs[0], y, yadd, ysub, sender_state.receiver,
+             sender_state.sender, sender_state.intersection);
+  });
+  auto receiver = std::async(std::launch::async, [&] {
+    UPsiRecv(lctxs[1], x, xadd, xsub, receiver_state.receiver,
+             receiver_state.sender, receiver_state.intersection);
+  });
+  sender.get();
+  receiver.get();
+}
+
+}  // namespace
+
+class UPsiSnapshotTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    dir_ = std::filesystem::temp_directory_path() / "upsi_snapshot_test";
+    std::filesystem::remove_all(dir_);
+    std::filesystem::create_directories(dir_);
+
+    x_ = CreateRangeItems(0, kNum);
+    y_ = CreateRangeItems(kNum / 2, kNum);
+    std::vector<uint128_t> base = CreateRangeItems(kNum / 2, kNum / 2);
+    receiver_state_.sender.UpdatePRFs(absl::MakeSpan(x_));
+    sender_state_.sender.UpdatePRFs(absl::MakeSpan(y_));
+    for (auto* state : {&receiver_state_, &sender_state_}) {
+      state->base_result = base;
+      state->intersection.Insert(base);
+    }
+  }
+
+  void TearDown() override { std::filesystem::remove_all(dir_); }
+
+  static constexpr size_t kNum = 1 << 10;
+  std::filesystem::path dir_;
+  std::vector<uint128_t> x_;
+  std::vector<uint128_t> y_;
+  UPsiPartyState receiver_state_;
+  UPsiPartyState sender_state_;
+};
+
+TEST_F(UPsiSnapshotTest, RestoreMidSequenceWorks) {
+  std::vector<uint128_t> add1 = CreateRangeItems(2 * kNum, 32);
+  std::vector<uint128_t> sub1 = CreateRangeItems(kNum / 2, 32);
+  // Round 2 also adds items the other party had from the start, which only
+  // match if the restored PRFs and keys are the ones they were made with.
+  std::vector<uint128_t> xadd2 = CreateRangeItems(3 * kNum, 32);
+  std::vector<uint128_t> x_only = CreateRangeItems(0, 16);
+  std::vector<uint128_t> y_only = CreateRangeItems(kNum + 16, 16);
+  std::vector<uint128_t> yadd2 = xadd2;
+  xadd2.insert(xadd2.end(), y_only.begin(), y_only.end());
+  yadd2.insert(yadd2.end(), x_only.begin(), x_only.end());
+  std::vector<uint128_t> sub2 = CreateRangeItems(kNum / 2 + 32, 16);
+  sub2.insert(sub2.end(), add1.begin(), add1.begin() + 16);
+
+  RunRound(receiver_state_, sender_state_, x_, y_, add1, sub1, add1, sub1);
+  std::string receiver_path = (dir_ / "receiver").string();
+  std::string sender_path = (dir_ / "sender").string();
+  SaveUPsiSnapshot(receiver_state_, receiver_path);
+  SaveUPsiSnapshot(sender_state_, sender_path);
+
+  UPsiPartyState restored_receiver;
+  UPsiPartyState restored_sender;
+  LoadUPsiSnapshot(receiver_path, &restored_receiver);
+  LoadUPsiSnapshot(sender_path, &restored_sender);
+  EXPECT_EQ(restored_receiver.intersection.ExportSorted(),
+            receiver_state_.intersection.ExportSorted());
+  EXPECT_EQ(restored_receiver.base_result, receiver_state_.base_result);
+  EXPECT_EQ(restored_sender.sender.GetPRFSize(),
+            sender_state_.sender.GetPRFSize());
+
+  RunRound(receiver_state_, sender_state_, x_, y_, xadd2, sub2, yadd2, sub2);
+  RunRound(restored_receiver, restored_sender, x_, y_, xadd2, sub2, yadd2,
+           sub2);
+
+  std::set<uint128_t> expected(receiver_state_.base_result.begin(),
+                               receiver_state_.base_result.end());
+  for (const auto* delta : {&sub1, &sub2}) {
+    for (const auto& item : *delta) {
+      expected.erase(item);
+    }
+  }
+  expected.insert(add1.begin() + 16, add1.end());
+  expected.insert(xadd2.begin(), xadd2.end());
+  expected.insert(x_only.begin(), x_only.end());
+  std::vector<uint128_t> result = receiver_state_.intersection.ExportSorted();
+  EXPECT_EQ(result, std::vector<uint128_t>(expected.begin(), expected.end()));
+  EXPECT_EQ(restored_receiver.intersection.ExportSorted(), result);
+  EXPECT_EQ(restored_sender.intersection.ExportSorted(), result);
+}
+
+TEST_F(UPsiSnapshotTest, RejectsOtherVersion) {
+  std::string path = (dir_ / "receiver").string();
+  SaveUPsiSnapshot(receiver_state_, path);
+  {
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(8);  // format version, after the magic
+    uint32_t version = 2;
+    file.write(reinterpret_cast<const char*>(&version), sizeof(version));
+  }
+  UPsiPartyState restored;
+  EXPECT_ANY_THROW(LoadUPsiSnapshot(path, &restored));
+
+  std::filesystem::resize_file(path, 40);
+  EXPECT_ANY_THROW(LoadUPsiSnapshot(path, &restored));
+}
+
+TEST_F(UPsiSnapshotTest, RejectsCountsThatWrapTheFileSize) {
+  std::string path = (dir_ / "receiver").string();
+  SaveUPsiSnapshot(receiver_state_, path);
+  {
+    // prf_count, after the magic and four 32-bit sizes. Adding 2^59 PRFs of
+    // 32 bytes adds 2^64 bytes, which a 64-bit product wraps to nothing.
+    std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekg(24);
+    uint64_t count;
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    count += uint64_t{1} << 59;
+    file.seekp(24);
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  }
+  // rejected by the size check, not by a failed allocation further on
+  UPsiPartyState restored;
+  EXPECT_THROW(LoadUPsiSnapshot(path, &restored), yacl::Exception);
+}
+
+TEST_F(UPsiSnapshotTest, SnapshotIsOwnerOnly) {
+  std::string path = (dir_ / "receiver").string();
+  // a stale temporary file left readable by everyone
+  std::ofstream(path + ".tmp") << "stale";
+  std::filesystem::permissions(path + ".tmp", std::filesystem::perms::all);
+  SaveUPsiSnapshot(receiver_state_, path);
+  struct stat st;
+  ASSERT_EQ(::stat(path.c_str(), &st), 0);
+  EXPECT_EQ(st.st_mode & 0777, 0600);
+  EXPECT_FALSE(std::filesystem::exists(path + ".tmp"));
+}
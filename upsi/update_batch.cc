@@ -0,0 +1,64 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "examples/upsi/update_batch.h"
+
+#include "yacl/base/exception.h"
+
+void UpdateBatch::Push(absl::Span<const uint128_t> add,
+                       absl::Span<const uint128_t> sub) {
+  // deletions first, so that an item may leave and come back in one epoch
+  for (const auto& item : sub) {
+    Apply(item, false);
+  }
+  for (const auto& item : add) {
+    Apply(item, true);
+  }
+  ++epochs_;
+}
+
+std::vector<uint128_t> UpdateBatch::Additions() const {
+  std::vector<uint128_t> ret;
+  for (const auto& [item, ops] : ops_) {
+    if (ops.first_add && ops.last_add) {
+      ret.push_back(item);
+    }
+  }
+  return ret;
+}
+
+std::vector<uint128_t> UpdateBatch::Deletions() const {
+  std::vector<uint128_t> ret;
+  for (const auto& [item, ops] : ops_) {
+    if (!ops.first_add && !ops.last_add) {
+      ret.push_back(item);
+    }
+  }
+  return ret;
+}
+
+void UpdateBatch::Clear() {
+  ops_.clear();
+  epochs_ = 0;
+}
+
+void UpdateBatch::Apply(uint128_t item, bool add) {
+  auto [it, inserted] = ops_.try_emplace(item, Ops{add, add});
+  if (!inserted) {
+    YACL_ENFORCE(it->second.last_add != add,
+                 "item {} twice in a row in epoch {}",
+                 add ? "added" : "deleted", epochs_);
+    it->second.last_add = add;
+  }
+}
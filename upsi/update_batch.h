@@ -0,0 +1,55 @@
+// Copyright 2024 Guowei LING.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//   http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <vector>
+
+#include "absl/types/span.h"
+
+#include "yacl/base/int128.h"
+
+// Add/delete epochs queued by one party, folded into the net change of its
+// set so that one uPSI round can apply all of them.
+//
+// Only the first and the last operation on an item matter. An item first
+// added and last deleted, or first deleted and last added, is left out; one
+// added and still there is an addition, and one deleted and not restored is
+// a deletion. Within the batch an item must alternate between Add and Delete,
+// as it would in a sequence of separate rounds.
+class UpdateBatch {
+ public:
+  // Appends one epoch.
+  void Push(absl::Span<const uint128_t> add, absl::Span<const uint128_t> sub);
+
+  // Net additions and deletions over all epochs, in increasing order.
+  std::vector<uint128_t> Additions() const;
+  std::vector<uint128_t> Deletions() const;
+
+  size_t epochs() const { return epochs_; }
+  void Clear();
+
+ private:
+  struct Ops {
+    bool first_add;
+    bool last_add;
+  };
+  void Apply(uint128_t item, bool add);
+
+  std::map<uint128_t, Ops> ops_;
+  size_t epochs_ = 0;
+};
@@ -38,17 +38,11 @@ std::vector<uint128_t> BasePsiSend(
   return rr22::RR22PsiSend(ctx, y, baxos);
 }
 
-std::vector<uint128_t> UPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
-                                std::vector<uint128_t>& x,
-                                std::vector<uint128_t>& xadd,
-                                std::vector<uint128_t>& xsub,
-                                EcdhReceiver& xaddreceiver,
-                                EcdhSender& yaddsender,
-                                std::set<uint128_t> intersection_receiver) {
-  yaddsender.UpdatePRFs(absl::MakeSpan(xadd));
-  yaddsender.DeletePRFs(absl::MakeSpan(xsub));
-  // cout << ctx->GetStats()->recv_bytes << endl;
-  // cout << ctx->GetStats()->sent_bytes << endl;
+void UPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
+              std::vector<uint128_t>& x, std::vector<uint128_t>& xadd,
+              std::vector<uint128_t>& xsub, EcdhReceiver& xaddreceiver,
+              EcdhSender& yaddsender, IntersectionState& intersection_receiver,
+              bool concurrent, examples::psi::LinkTraffic* spawned_traffic) {
   uint32_t xadd_size = xadd.size();
   std::vector<uint8_t> size_data(
       reinterpret_cast<uint8_t*>(&xadd_size),
@@ -57,47 +51,52 @@ std::vector<uint128_t> UPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
   yacl::Buffer size_data_yadd = ctx->Recv(ctx->PrevRank(), "yadd size");
   uint32_t yadd_size = *reinterpret_cast<uint32_t*>(size_data_yadd.data());
   // cout << "yadd_size = " << yadd_size << endl;
-  yaddsender.EcdhPsiSend(ctx, yadd_size);
-  std::vector<uint128_t> t = xaddreceiver.EcdhPsiRecv(ctx, xadd);
-  // cout << "t=" << t.size() << endl;
 
-  std::vector<uint128_t> u = KrtwPsuSend(ctx, t);
+  std::vector<uint128_t> xsubintersction = intersection_receiver.Filter(xsub);
+
+  // Spawned in the same order as in UPsiSend.
+  std::shared_ptr<yacl::link::Context> yadd_ctx = ctx->Spawn();
+  std::shared_ptr<yacl::link::Context> xadd_ctx = ctx->Spawn();
+  std::shared_ptr<yacl::link::Context> sub_ctx = ctx->Spawn();
+  auto yadd_psi = [&] {
+    yaddsender.UpdatePRFs(absl::MakeSpan(xadd));
+    yaddsender.DeletePRFs(absl::MakeSpan(xsub));
+    yaddsender.EcdhPsiSend(yadd_ctx, yadd_size);
+  };
+  auto xadd_psi = [&] { return xaddreceiver.EcdhPsiRecv(xadd_ctx, xadd); };
+  auto sub_psu = [&] { return KrtwPsuSend(sub_ctx, xsubintersction); };
+
+  std::vector<uint128_t> u;
+  std::vector<uint128_t> w;
+  if (concurrent) {
+    auto sub_task = std::async(std::launch::async, sub_psu);
+    auto yadd_task = std::async(std::launch::async, yadd_psi);
+    std::vector<uint128_t> t = xadd_psi();
+    u = KrtwPsuSend(ctx, t);
+    yadd_task.get();
+    w = sub_task.get();
+  } else {
+    yadd_psi();
+    std::vector<uint128_t> t = xadd_psi();
+    u = KrtwPsuSend(ctx, t);
+    w = sub_psu();
+  }
   // cout << "u=" << u.size() << endl;
-
-  std::set<uint128_t> xsubset(xsub.begin(), xsub.end());
-  std::set<uint128_t> xsubsetintersction;
-  std::set_intersection(
-      xsubset.begin(), xsubset.end(), intersection_receiver.begin(),
-      intersection_receiver.end(),
-      std::inserter(xsubsetintersction, xsubsetintersction.begin()));
-  std::vector<uint128_t> xsubintersction(xsubsetintersction.begin(),
-                                         xsubsetintersction.end());
-
-  std::vector<uint128_t> w = KrtwPsuSend(ctx, xsubintersction);
   // cout << "w=" << w.size() << endl;
-  std::set<uint128_t> wset(w.begin(), w.end());
-
-  for (const auto& elem : wset) {
-    intersection_receiver.erase(elem);
+  intersection_receiver.Erase(w);
+  intersection_receiver.Insert(u);
+  if (spawned_traffic != nullptr) {
+    spawned_traffic->Add(*yadd_ctx);
+    spawned_traffic->Add(*xadd_ctx);
+    spawned_traffic->Add(*sub_ctx);
   }
-
-  for (const auto& elem : u) {
-    intersection_receiver.insert(elem);
-  }
-  std::vector<uint128_t> psi_result(intersection_receiver.begin(),
-                                    intersection_receiver.end());
-  return psi_result;
 }
 
-std::vector<uint128_t> UPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
-                                std::vector<uint128_t>& y,
-                                std::vector<uint128_t>& yadd,
-                                std::vector<uint128_t>& ysub,
-                                EcdhReceiver& yaddreceiver,
-                                EcdhSender& xaddsender,
-                                std::set<uint128_t> intersection_sender) {
-  xaddsender.UpdatePRFs(absl::MakeSpan(yadd));
-  xaddsender.DeletePRFs(absl::MakeSpan(ysub));
+void UPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
+              std::vector<uint128_t>& y, std::vector<uint128_t>& yadd,
+              std::vector<uint128_t>& ysub, EcdhReceiver& yaddreceiver,
+              EcdhSender& xaddsender, IntersectionState& intersection_sender,
+              bool concurrent, examples::psi::LinkTraffic* spawned_traffic) {
   uint32_t yadd_size = yadd.size();
   std::vector<uint8_t> size_data(
       reinterpret_cast<uint8_t*>(&yadd_size),
@@ -105,33 +104,65 @@ std::vector<uint128_t> UPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
   ctx->SendAsync(ctx->NextRank(), size_data, "yadd_size");
   yacl::Buffer size_data_xadd = ctx->Recv(ctx->PrevRank(), "xadd size");
   uint32_t xadd_size = *reinterpret_cast<uint32_t*>(size_data_xadd.data());
-  std::vector<uint128_t> v = yaddreceiver.EcdhPsiRecv(ctx, yadd);
-  // cout << "v = " << v.size() << endl;
-
-  xaddsender.EcdhPsiSend(ctx, xadd_size);
-  std::vector<uint128_t> u = KrtwPsuRecv(ctx, v);
-  // cout << "u = " << u.size() << endl;
 
-  std::set<uint128_t> ysubset(ysub.begin(), ysub.end());
-  std::set<uint128_t> ysubsetintersction;
-  std::set_intersection(
-      ysubset.begin(), ysubset.end(), intersection_sender.begin(),
-      intersection_sender.end(),
-      std::inserter(ysubsetintersction, ysubsetintersction.begin()));
-  std::vector<uint128_t> ysubintersction(ysubsetintersction.begin(),
-                                         ysubsetintersction.end());
-  // cout << ysubintersction.size() << endl;
-  std::vector<uint128_t> w = KrtwPsuRecv(ctx, ysubintersction);
-  // cout<<w.size()<<endl;
-  std::set<uint128_t> wset(w.begin(), w.end());
-
-  for (const auto& elem : wset) {
-    intersection_sender.erase(elem);
+  std::vector<uint128_t> ysubintersction = intersection_sender.Filter(ysub);
+
+  // Spawned in the same order as in UPsiRecv.
+  std::shared_ptr<yacl::link::Context> yadd_ctx = ctx->Spawn();
+  std::shared_ptr<yacl::link::Context> xadd_ctx = ctx->Spawn();
+  std::shared_ptr<yacl::link::Context> sub_ctx = ctx->Spawn();
+  auto yadd_psi = [&] { return yaddreceiver.EcdhPsiRecv(yadd_ctx, yadd); };
+  auto xadd_psi = [&] {
+    xaddsender.UpdatePRFs(absl::MakeSpan(yadd));
+    xaddsender.DeletePRFs(absl::MakeSpan(ysub));
+    xaddsender.EcdhPsiSend(xadd_ctx, xadd_size);
+  };
+  auto sub_psu = [&] { return KrtwPsuRecv(sub_ctx, ysubintersction); };
+
+  std::vector<uint128_t> u;
+  std::vector<uint128_t> w;
+  if (concurrent) {
+    auto sub_task = std::async(std::launch::async, sub_psu);
+    auto xadd_task = std::async(std::launch::async, xadd_psi);
+    std::vector<uint128_t> v = yadd_psi();
+    u = KrtwPsuRecv(ctx, v);
+    xadd_task.get();
+    w = sub_task.get();
+  } else {
+    std::vector<uint128_t> v = yadd_psi();
+    xadd_psi();
+    u = KrtwPsuRecv(ctx, v);
+    w = sub_psu();
   }
-  for (const auto& elem : u) {
-    intersection_sender.insert(elem);
+  // cout << "u = " << u.size() << endl;
+  // cout << w.size() << endl;
+  intersection_sender.Erase(w);
+  intersection_sender.Insert(u);
+  if (spawned_traffic != nullptr) {
+    spawned_traffic->Add(*yadd_ctx);
+    spawned_traffic->Add(*xadd_ctx);
+    spawned_traffic->Add(*sub_ctx);
   }
-  std::vector<uint128_t> psi_result(intersection_sender.begin(),
-                                    intersection_sender.end());
-  return psi_result;
-}
\ No newline at end of file
+}
+
+void UPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
+              std::vector<uint128_t>& x, const UpdateBatch& xupdates,
+              EcdhReceiver& xaddreceiver, EcdhSender& yaddsender,
+              IntersectionState& intersection_receiver, bool concurrent,
+              examples::psi::LinkTraffic* spawned_traffic) {
+  std::vector<uint128_t> xadd = xupdates.Additions();
+  std::vector<uint128_t> xsub = xupdates.Deletions();
+  UPsiRecv(ctx, x, xadd, xsub, xaddreceiver, yaddsender, intersection_receiver,
+           concurrent, spawned_traffic);
+}
+
+void UPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
+              std::vector<uint128_t>& y, const UpdateBatch& yupdates,
+              EcdhReceiver& yaddreceiver, EcdhSender& xaddsender,
+              IntersectionState& intersection_sender, bool concurrent,
+              examples::psi::LinkTraffic* spawned_traffic) {
+  std::vector<uint128_t> yadd = yupdates.Additions();
+  std::vector<uint128_t> ysub = yupdates.Deletions();
+  UPsiSend(ctx, y, yadd, ysub, yaddreceiver, xaddsender, intersection_sender,
+           concurrent, spawned_traffic);
+}
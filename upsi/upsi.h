@@ -17,9 +17,12 @@
 #include <memory>
 #include <vector>
 
+#include "examples/psi/link_traffic.h"
 #include "examples/upsi/ecdhpsi/receiver.h"
 #include "examples/upsi/ecdhpsi/sender.h"
+#include "examples/upsi/intersection_state.h"
 #include "examples/upsi/rr22/okvs/baxos.h"
+#include "examples/upsi/update_batch.h"
 
 #include "yacl/base/int128.h"
 #include "yacl/link/context.h"
@@ -32,18 +35,41 @@ std::vector<uint128_t> BasePsiSend(
     const std::shared_ptr<yacl::link::Context>& ctx, std::vector<uint128_t>& y,
     okvs::Baxos baxos);
 
-std::vector<uint128_t> UPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
-                                std::vector<uint128_t>& x,
-                                std::vector<uint128_t>& xadd,
-                                std::vector<uint128_t>& xsub,
-                                EcdhReceiver& xaddreceiver,
-                                EcdhSender& yaddsender,
-                                std::set<uint128_t> intersection_receiver);
-
-std::vector<uint128_t> UPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
-                                std::vector<uint128_t>& y,
-                                std::vector<uint128_t>& yadd,
-                                std::vector<uint128_t>& ysub,
-                                EcdhReceiver& yaddreceiver,
-                                EcdhSender& xaddsender,
-                                std::set<uint128_t> intersection_sender);
\ No newline at end of file
+// One update round, applied to the caller's intersection in place. The ECDH
+// PSI in each direction and the PSU over the deleted items share no state, so
+// with concurrent they run at once on contexts spawned from ctx, and the PSU
+// over the additions follows on ctx as soon as its ECDH input is ready.
+// Without it they run one after another.
+//
+// The spawned contexts keep their own link statistics. If spawned_traffic is
+// not null, their counters are added there on return, so the caller can
+// report them together with those of ctx.
+void UPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
+              std::vector<uint128_t>& x, std::vector<uint128_t>& xadd,
+              std::vector<uint128_t>& xsub, EcdhReceiver& xaddreceiver,
+              EcdhSender& yaddsender, IntersectionState& intersection_receiver,
+              bool concurrent = true,
+              examples::psi::LinkTraffic* spawned_traffic = nullptr);
+
+void UPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
+              std::vector<uint128_t>& y, std::vector<uint128_t>& yadd,
+              std::vector<uint128_t>& ysub, EcdhReceiver& yaddreceiver,
+              EcdhSender& xaddsender, IntersectionState& intersection_sender,
+              bool concurrent = true,
+              examples::psi::LinkTraffic* spawned_traffic = nullptr);
+
+// One round applying every epoch queued in xupdates (resp. yupdates) at once.
+// The parties may have queued different numbers of epochs.
+void UPsiRecv(const std::shared_ptr<yacl::link::Context>& ctx,
+              std::vector<uint128_t>& x, const UpdateBatch& xupdates,
+              EcdhReceiver& xaddreceiver, EcdhSender& yaddsender,
+              IntersectionState& intersection_receiver,
+              bool concurrent = true,
+              examples::psi::LinkTraffic* spawned_traffic = nullptr);
+
+void UPsiSend(const std::shared_ptr<yacl::link::Context>& ctx,
+              std::vector<uint128_t>& y, const UpdateBatch& yupdates,
+              EcdhReceiver& yaddreceiver, EcdhSender& xaddsender,
+              IntersectionState& intersection_sender,
+              bool concurrent = true,
+              examples::psi::LinkTraffic* spawned_traffic = nullptr);